@@ -0,0 +1,44 @@
+﻿#pragma once
+
+struct Aabb final
+{
+	glm::vec3 min{};
+	glm::vec3 max{};
+
+	[[nodiscard]] bool Contains(const Aabb& other) const;
+	[[nodiscard]] float GetSurfaceArea() const;
+	// Returns the bounds of this box after being transformed by the matrix.
+	[[nodiscard]] Aabb Transform(const glm::mat4& matrix) const;
+
+	[[nodiscard]] static Aabb Combine(const Aabb& a, const Aabb& b);
+};
+
+inline bool Aabb::Contains(const Aabb& other) const
+{
+	return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::lessThanEqual(other.max, max));
+}
+
+inline float Aabb::GetSurfaceArea() const
+{
+	const glm::vec3 size = max - min;
+	return 2 * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+inline Aabb Aabb::Transform(const glm::mat4& matrix) const
+{
+	const glm::vec3 center = matrix * glm::vec4((min + max) * .5f, 1);
+	const glm::vec3 extents = (max - min) * .5f;
+
+	// The rotated extents are the absolute sum of the scaled axes.
+	const glm::vec3 rotatedExtents =
+		glm::abs(glm::vec3(matrix[0])) * extents.x +
+		glm::abs(glm::vec3(matrix[1])) * extents.y +
+		glm::abs(glm::vec3(matrix[2])) * extents.z;
+
+	return { center - rotatedExtents, center + rotatedExtents };
+}
+
+inline Aabb Aabb::Combine(const Aabb& a, const Aabb& b)
+{
+	return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+}
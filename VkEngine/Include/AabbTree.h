@@ -0,0 +1,130 @@
+﻿#pragma once
+#include <mutex>
+#include <shared_mutex>
+#include "Aabb.h"
+#include "Frustum.h"
+
+// Dynamic bounding volume hierarchy over every entity that has both a Transform3d and a Mesh.
+// Any number of threads can query the tree, while Update applies the changes of a frame in one batch.
+class AabbTree final
+{
+public:
+	typedef Singleton<AabbTree> Instance;
+
+	struct Settings final
+	{
+		// Leaves are enlarged by this margin, so that small movements don't change the tree.
+		float margin = .1f;
+		// Rebuilds the tree from scratch every n updates, or never when zero.
+		uint32_t rebuildInterval = 600;
+	};
+
+	explicit AabbTree(uint32_t size);
+	AabbTree(uint32_t size, const Settings& settings);
+
+	void Update();
+	void Rebuild();
+
+	// The enlarged bounds only steer the traversal, leaves are tested with the exact bounds of their entity.
+	void QueryAabb(const Aabb& aabb, std::vector<uint32_t>& outSparseIds) const;
+	void QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& outSparseIds) const;
+	void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& outSparseIds) const;
+	// Finds the closest entity with bounds that intersect the ray.
+	[[nodiscard]] bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+		uint32_t& outSparseId, float& outDistance) const;
+
+private:
+	struct Node final
+	{
+		// Padded to four floats for the vector tests.
+		float min[4];
+		float max[4];
+		int32_t parent = -1;
+		int32_t children[2]{ -1, -1 };
+		uint32_t sparseId = 0;
+
+		[[nodiscard]] bool IsLeaf() const;
+		[[nodiscard]] Aabb GetAabb() const;
+		void SetAabb(const Aabb& aabb);
+	};
+
+	struct Bounds final
+	{
+		float min[4];
+		float max[4];
+	};
+
+	Settings _settings;
+	std::vector<Node> _nodes{};
+	std::vector<int32_t> _freeNodes{};
+	int32_t _root = -1;
+	uint32_t _updateCount = 0;
+	mutable std::shared_mutex _mutex{};
+
+	std::vector<int32_t> _leaves{};
+	// Exact bounds of every entity in the tree, which are filled on the side and swapped in under the lock.
+	std::vector<Bounds> _bounds{};
+	std::vector<Bounds> _nextBounds{};
+	std::vector<uint32_t> _updateStamps{};
+	std::vector<std::pair<uint32_t, Aabb>> _changes{};
+	std::vector<uint32_t> _removals{};
+	std::vector<int32_t> _buildNodes{};
+
+	[[nodiscard]] int32_t AllocateNode();
+	void FreeNode(int32_t index);
+
+	void InsertLeaf(int32_t leaf);
+	void RemoveLeaf(int32_t leaf);
+	void Refit(int32_t index);
+
+	void BuildTree();
+	[[nodiscard]] int32_t Build(int32_t* leaves, uint32_t count);
+
+	// Calls test(min, max) for the bounds of every node that is reached, where leaves are tested with their exact bounds as well.
+	template <typename Test, typename Visit>
+	void Traverse(Test test, Visit visit) const;
+};
+
+template <typename Test, typename Visit>
+void AabbTree::Traverse(Test test, Visit visit) const
+{
+	std::shared_lock lock(_mutex);
+	if (_root == -1)
+		return;
+
+	int32_t stack[64];
+	std::vector<int32_t> overflow{};
+	uint32_t count = 0;
+	stack[count++] = _root;
+
+	while (count > 0 || !overflow.empty())
+	{
+		int32_t index;
+		if (!overflow.empty())
+		{
+			index = overflow.back();
+			overflow.pop_back();
+		}
+		else
+			index = stack[--count];
+
+		const auto& node = _nodes[index];
+		if (!test(node.min, node.max))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			const auto& bounds = _bounds[node.sparseId];
+			if (test(bounds.min, bounds.max))
+				visit(node);
+			continue;
+		}
+
+		// Degenerate trees can be deeper than the stack, which is only possible between rebuilds.
+		for (const int32_t child : node.children)
+			if (count < 64)
+				stack[count++] = child;
+			else
+				overflow.push_back(child);
+	}
+}
@@ -0,0 +1,59 @@
+﻿#pragma once
+#include <chrono>
+#include <functional>
+#include <string>
+
+// Runs work that doesn't have to finish in a single frame within a time budget, so that bursts of it are spread over multiple frames.
+class BudgetScheduler final
+{
+public:
+	typedef Singleton<BudgetScheduler> Instance;
+	// Does a small step of work, and returns true while there is more work left.
+	// A task is called again in a later frame after it returned false, so it can pick up work that comes in later.
+	typedef std::function<bool()> Task;
+
+	struct Settings final
+	{
+		// Time in microseconds that can be spent on tasks every frame.
+		uint32_t budget = 1000;
+	};
+
+	struct Stats final
+	{
+		std::string name;
+		uint64_t steps = 0;
+		double microseconds = 0;
+		uint32_t frameSteps = 0;
+		float frameMicroseconds = 0;
+		float maxStepMicroseconds = 0;
+		// True if the task still had work left when the budget ran out.
+		bool pending = false;
+	};
+
+	BudgetScheduler();
+	explicit BudgetScheduler(const Settings& settings);
+
+	// Returns the id of the task, which is used to look up its stats.
+	uint32_t Add(const std::string& name, const Task& task);
+	// Has to be called before anything the task uses is destroyed. The id can be handed out again by Add.
+	void Remove(uint32_t id);
+
+	// Runs the tasks until they are out of work or the budget has been spent.
+	void Run();
+	void Run(uint32_t budget);
+
+	[[nodiscard]] const Stats& GetStats(uint32_t id) const;
+	[[nodiscard]] uint32_t GetTaskCount() const;
+	// The time spent by the last run, which can exceed the budget by the duration of a single step.
+	[[nodiscard]] float GetFrameMicroseconds() const;
+
+private:
+	Settings _settings;
+	std::vector<Task> _tasks{};
+	std::vector<Stats> _stats{};
+	std::vector<bool> _finished{};
+	std::vector<uint32_t> _freeIds{};
+	// Continues where the previous run ran out of budget.
+	uint32_t _cursor = 0;
+	float _frameMicroseconds = 0;
+};
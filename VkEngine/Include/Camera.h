@@ -4,15 +4,13 @@
 #include "VkRenderer/BindingInfo.h"
 #include "VkRenderer/DescriptorLayoutInfo.h"
 
+// Cameras write their uniforms to the uniform ring every frame, so they don't own any frame resources.
 struct CameraFrame final
 {
-	VkBuffer buffer;
-	VkDeviceMemory memory;
-	VkDescriptorSet descriptor;
 };
 
 template <typename Camera, typename Ubo>
-class CameraSystem : public ShaderSet<Camera, CameraFrame>
+class CameraSystem : public ShaderSet<Camera, CameraFrame, CameraSystem<Camera, Ubo>>
 {
 public:
 	typedef Singleton<CameraSystem> Instance;
@@ -22,41 +20,63 @@ public:
 	void Update() override;
 
 	[[nodiscard]] VkDescriptorSetLayout GetLayout() const;
+	// Binds the uniforms of any camera, selected by passing its uniform offset as the dynamic offset.
+	[[nodiscard]] VkDescriptorSet GetDescriptorSet() const;
+	// The offset of a camera's uniforms in the frame that is being recorded, by its index in the packet.
+	// Can only be used by passes on the render thread that are recorded after the camera pass.
+	[[nodiscard]] uint32_t GetUniformOffset(uint32_t index) const;
 
 protected:
 	[[nodiscard]] virtual Ubo CreateUbo(Camera& camera, uint32_t index) = 0;
 
 private:
-	void ConstructInstanceFrame(CameraFrame& frame, Camera& material, uint32_t denseId) override;
-	void CleanupInstanceFrame(CameraFrame& frame, Camera& material, uint32_t denseId) override;
+	friend ShaderSet<Camera, CameraFrame, CameraSystem<Camera, Ubo>>;
+
+	// The uniforms that are written on the render thread, in dense order.
+	struct Packet final
+	{
+		std::vector<Ubo> ubos{};
+	};
+
+	void Render(uint32_t packetIndex);
 
 	vi::BindingInfo _bindingInfo{};
 	VkDescriptorSetLayout _descriptorLayout;
 	DescriptorPool _descriptorPool;
+	VkDescriptorSet _descriptorSet;
+	Packet _packets[RenderThread::packetCount];
+	std::vector<uint32_t> _uniformOffsets{};
 };
 
 template <typename Camera, typename Ubo>
-CameraSystem<Camera, Ubo>::CameraSystem(const uint32_t size) : ShaderSet<Camera, CameraFrame>(size)
+CameraSystem<Camera, Ubo>::CameraSystem(const uint32_t size) : ShaderSet<Camera, CameraFrame, CameraSystem<Camera, Ubo>>(size)
 {
 	auto& renderSystem = RenderSystem::Instance::Get();
 	auto& renderer = renderSystem.GetVkRenderer();
-	auto& swapChain = renderSystem.GetSwapChain();
+	auto& uniformRing = renderSystem.GetUniformRing();
 
 	vi::DescriptorLayoutInfo camLayoutInfo{};
+	_bindingInfo.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	_bindingInfo.size = sizeof Ubo;
 	_bindingInfo.flag = VK_SHADER_STAGE_VERTEX_BIT;
 	camLayoutInfo.bindings.push_back(_bindingInfo);
 	_descriptorLayout = renderer.CreateLayout(camLayoutInfo);
 
-	const uint32_t imageCount = swapChain.GetImageCount();
-	VkDescriptorType uboType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	_descriptorPool.Construct(imageCount * ShaderSet<Camera, CameraFrame>::GetSize(), _descriptorLayout, &uboType, 1);
+	VkDescriptorType uboType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	_descriptorPool.Construct(1, _descriptorLayout, &uboType, 1);
+	_descriptorSet = _descriptorPool.Get();
+	renderer.BindBuffer(_descriptorSet, uniformRing.GetBuffer(), _bindingInfo, 0, 0);
+
+	RenderThread::Instance::Get().AddPass([this](const uint32_t packetIndex)
+	{
+		Render(packetIndex);
+	});
 }
 
 template <typename Camera, typename Ubo>
 void ::CameraSystem<Camera, Ubo>::Cleanup()
 {
-	ShaderSet<Camera, CameraFrame>::Cleanup();
+	ShaderSet<Camera, CameraFrame, CameraSystem<Camera, Ubo>>::Cleanup();
 
 	_descriptorPool.Cleanup();
 }
@@ -64,20 +84,15 @@ void ::CameraSystem<Camera, Ubo>::Cleanup()
 template <typename Camera, typename Ubo>
 void ::CameraSystem<Camera, Ubo>::Update()
 {
-	ShaderSet<Camera, CameraFrame>::Update();
+	ShaderSet<Camera, CameraFrame, CameraSystem<Camera, Ubo>>::Update();
 
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& renderer = renderSystem.GetVkRenderer();
-	auto frames = ShaderSet<Camera, CameraFrame>::GetCurrentFrameSet();
+	auto& renderThread = RenderThread::Instance::Get();
 
-	for (const auto [instance, sparseId] : *this)
-	{
-		const uint32_t denseId = ShaderSet<Camera, CameraFrame>::GetDenseId(sparseId);
-		auto& frame = frames.template Get<CameraFrame>(denseId);
+	auto& packet = _packets[renderThread.GetPacketIndex()];
+	packet.ubos.clear();
 
-		Ubo ubo = CreateUbo(instance, sparseId);
-		renderer.MapMemory(frame.memory, &ubo, 0, 1);
-	}
+	for (const auto [instance, sparseId] : *this)
+		packet.ubos.push_back(CreateUbo(instance, sparseId));
 }
 
 template <typename Camera, typename Ubo>
@@ -87,26 +102,26 @@ VkDescriptorSetLayout CameraSystem<Camera, Ubo>::GetLayout() const
 }
 
 template <typename Camera, typename Ubo>
-void ::CameraSystem<Camera, Ubo>::ConstructInstanceFrame(CameraFrame& frame, Camera&, const uint32_t)
+VkDescriptorSet CameraSystem<Camera, Ubo>::GetDescriptorSet() const
 {
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& renderer = renderSystem.GetVkRenderer();
-
-	frame.descriptor = _descriptorPool.Get();
+	return _descriptorSet;
+}
 
-	frame.buffer = renderer.CreateBuffer<Ubo>(1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-	frame.memory = renderer.AllocateMemory(frame.buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	renderer.BindMemory(frame.buffer, frame.memory);
-	renderer.BindBuffer(frame.descriptor, frame.buffer, _bindingInfo, 0, 0);
+template <typename Camera, typename Ubo>
+uint32_t CameraSystem<Camera, Ubo>::GetUniformOffset(const uint32_t index) const
+{
+	assert(index < _uniformOffsets.size());
+	return _uniformOffsets[index];
 }
 
 template <typename Camera, typename Ubo>
-void ::CameraSystem<Camera, Ubo>::CleanupInstanceFrame(CameraFrame& frame, Camera&, const uint32_t)
+void ::CameraSystem<Camera, Ubo>::Render(const uint32_t packetIndex)
 {
 	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& renderer = renderSystem.GetVkRenderer();
+	auto& uniformRing = renderSystem.GetUniformRing();
+	auto& packet = _packets[packetIndex];
 
-	_descriptorPool.Add(frame.descriptor);
-	renderer.FreeMemory(frame.memory);
-	renderer.DestroyBuffer(frame.buffer);
+	_uniformOffsets.clear();
+	for (const auto& ubo : packet.ubos)
+		_uniformOffsets.push_back(uniformRing.Write(ubo));
 }
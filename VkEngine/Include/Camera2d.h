@@ -10,8 +10,13 @@ struct Camera2d final
 	class System final : public CameraSystem<Camera2d, Ubo>
 	{
 	public:
+		typedef Singleton<System> Instance;
+
 		explicit System(uint32_t size);
 
+		// The world space area that is visible to the camera, as the minimum and the maximum corner.
+		[[nodiscard]] glm::vec4 GetViewRect(uint32_t sparseId);
+
 	protected:
 		[[nodiscard]] Ubo CreateUbo(Camera2d& camera, uint32_t index) override;
 	};
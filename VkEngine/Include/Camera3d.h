@@ -13,8 +13,12 @@ struct Camera3d final
 	class System final : public CameraSystem<Camera3d, Ubo>
 	{
 	public:
+		typedef Singleton<System> Instance;
+
 		explicit System(uint32_t size);
 
+		[[nodiscard]] glm::mat4 GetViewProjection(uint32_t sparseId);
+
 	protected:
 		[[nodiscard]] Ubo CreateUbo(Camera3d& camera, uint32_t index) override;
 	};
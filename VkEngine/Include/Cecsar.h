@@ -1,5 +1,6 @@
 #pragma once
 #include "Entity.h"
+#include "Prefab.h"
 #include "SparseSet.h"
 #include <queue>
 #include <vector>
@@ -9,11 +10,16 @@ namespace ce
 	class Cecsar
 	{
 	public:
-		explicit Cecsar(uint32_t size);
+		explicit Cecsar(uint32_t size, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
 		Entity AddEntity();
+		// Only erases the entity itself, so its components have to be erased from their sets beforehand.
 		void EraseEntity(uint32_t index);
 
+		// Adds count entities and clones the prefab onto them.
+		// Reused indices can still be in sets that delay erasing, like the shader sets, which revive those instances with the prefab's values.
+		void Instantiate(const Prefab& prefab, uint32_t count, std::vector<Entity>& outEntities);
+
 		void AddSet(Set* set);
 
 	private:
@@ -21,5 +27,6 @@ namespace ce
 		SparseSet<Entity> _entities;
 		std::priority_queue<int32_t, std::vector<int32_t>, std::greater<>> _openPq{};
 		std::vector<Set*> _sets{};
+		std::vector<uint32_t> _instantiateIds{};
 	};
 }
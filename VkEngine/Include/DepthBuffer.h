@@ -1,8 +1,9 @@
 #pragma once
+#include "VkRenderer/MemoryAllocator.h"
 
 struct DepthBuffer final
 {
 	VkImage image;
 	VkImageView imageView;
-	VkDeviceMemory imageMemory;
+	vi::Allocation imageMemory;
 };
\ No newline at end of file
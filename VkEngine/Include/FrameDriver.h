@@ -0,0 +1,38 @@
+﻿#pragma once
+#include <chrono>
+
+// Runs the simulation at a fixed tick rate, independent of how often frames are rendered.
+class FrameDriver final
+{
+public:
+	typedef Singleton<FrameDriver> Instance;
+
+	struct Settings final
+	{
+		float tickRate = 60;
+		// Limits the ticks per frame, so that the simulation gives up on catching up after a long hitch.
+		uint32_t maxTicksPerFrame = 4;
+	};
+
+	FrameDriver();
+	explicit FrameDriver(const Settings& settings);
+
+	// Adds the time passed since the previous frame, and determines how many ticks are due.
+	void BeginFrame();
+	// Returns true while a tick is due, and should be called in a loop that simulates a single tick each iteration.
+	[[nodiscard]] bool Tick();
+
+	// How far the rendered frame is between the previous and the current tick.
+	[[nodiscard]] float GetAlpha() const;
+	// The duration of a tick in seconds.
+	[[nodiscard]] float GetTickDelta() const;
+	[[nodiscard]] uint64_t GetTickCount() const;
+
+private:
+	Settings _settings;
+	double _tickDelta;
+	double _accumulator = 0;
+	uint32_t _pendingTicks = 0;
+	uint64_t _tickCount = 0;
+	std::chrono::steady_clock::time_point _previousTime;
+};
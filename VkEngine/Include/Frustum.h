@@ -0,0 +1,29 @@
+﻿#pragma once
+
+struct Frustum final
+{
+	// Left, right, bottom, top, near and far.
+	// Normals point inwards, so points inside have a positive distance to every plane.
+	glm::vec4 planes[6];
+
+	// Extracts the planes from a view projection matrix with a [0, 1] depth range.
+	[[nodiscard]] static Frustum FromMatrix(const glm::mat4& viewProjection);
+};
+
+inline Frustum Frustum::FromMatrix(const glm::mat4& viewProjection)
+{
+	const glm::mat4 m = glm::transpose(viewProjection);
+
+	Frustum frustum{};
+	frustum.planes[0] = m[3] + m[0];
+	frustum.planes[1] = m[3] - m[0];
+	frustum.planes[2] = m[3] + m[1];
+	frustum.planes[3] = m[3] - m[1];
+	frustum.planes[4] = m[2];
+	frustum.planes[5] = m[3] - m[2];
+
+	for (auto& plane : frustum.planes)
+		plane /= glm::length(glm::vec3(plane));
+
+	return frustum;
+}
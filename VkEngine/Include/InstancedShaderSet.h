@@ -0,0 +1,283 @@
+﻿#pragma once
+#include "ShaderSet.h"
+#include "MaterialCache.h"
+#include "FileReader.h"
+#include "VkRenderer/PipelineInfo.h"
+#include "VkRenderer/DescriptorLayoutInfo.h"
+
+// Draws textured meshes with instancing, drawing the instances that share a mesh and a material, or only a mesh when bindless, together.
+// Material has the diffuseTexture, diffuseFilter and material members, and Derived culls and batches the instances in FillPacket.
+template <typename Material, typename Frame, typename Vertex, typename Camera, typename Derived>
+class InstancedShaderSet : public ShaderSet<Material, Frame, Derived>
+{
+public:
+	// The fragment shader is picked from the last two depending on whether rendering is bindless.
+	InstancedShaderSet(uint32_t size, const char* vertPath, const char* fragPath, const char* bindlessFragPath);
+	void Cleanup() override;
+	void Update() override;
+
+protected:
+	// Everything needed to record an instanced draw, copied so that the sets can change while the packet is being recorded.
+	struct Batch final
+	{
+		VkBuffer vertexBuffer;
+		VkBuffer indexBuffer;
+		uint32_t indCount;
+		VkDescriptorSet descriptorSet;
+		uint32_t material;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+	};
+
+	struct Packet final
+	{
+		VkDescriptorSet cameraSet = VK_NULL_HANDLE;
+		uint32_t frameSlot = 0;
+		std::vector<Batch> batches{};
+		std::vector<typename Vertex::Instance> instances{};
+	};
+
+	// Bindless materials index the global texture array instead of owning descriptor sets.
+	bool _bindless;
+	MaterialCache _materialCache;
+
+private:
+	friend ShaderSet<Material, Frame, Derived>;
+
+	// Holds the instance data of a frame slot, and is only touched by the render thread.
+	struct InstanceBuffer final
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		vi::Allocation memory{};
+		// Stays mapped for as long as the buffer exists.
+		void* data = nullptr;
+		uint32_t capacity = 0;
+	};
+
+	vi::Pipeline _pipeline;
+	VkShaderModule _vertModule;
+	VkShaderModule _fragModule;
+	Packet _packets[RenderThread::packetCount];
+	std::vector<InstanceBuffer> _instanceBuffers{};
+
+	void ConstructInstances(uint32_t denseId, uint32_t count);
+	void ReviveInstance(Material& material, const Material& value, uint32_t denseId);
+	void CleanupInstance(Material& material, uint32_t denseId);
+
+	void Render(uint32_t packetIndex);
+	void ReserveInstances(InstanceBuffer& instanceBuffer, uint32_t count) const;
+};
+
+template <typename Material, typename Frame, typename Vertex, typename Camera, typename Derived>
+InstancedShaderSet<Material, Frame, Vertex, Camera, Derived>::InstancedShaderSet(const uint32_t size,
+	const char* vertPath, const char* fragPath, const char* bindlessFragPath) : ShaderSet<Material, Frame, Derived>(size)
+{
+	auto& renderSystem = RenderSystem::Instance::Get();
+	auto& renderer = renderSystem.GetVkRenderer();
+	auto& swapChain = renderSystem.GetSwapChain();
+
+	auto& cameraSystem = Camera::Instance::Get();
+	_bindless = renderSystem.IsBindless();
+
+	const auto vertCode = FileReader::Read(vertPath);
+	const auto fragCode = FileReader::Read(_bindless ? bindlessFragPath : fragPath);
+
+	_vertModule = renderer.CreateShaderModule(vertCode);
+	_fragModule = renderer.CreateShaderModule(fragCode);
+
+	auto layout = renderSystem.GetBindlessLayout();
+	if (!_bindless)
+	{
+		vi::DescriptorLayoutInfo materialLayoutInfo{};
+		vi::BindingInfo diffuseBinding{};
+		diffuseBinding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		diffuseBinding.flag = VK_SHADER_STAGE_FRAGMENT_BIT;
+		materialLayoutInfo.bindings.push_back(diffuseBinding);
+		layout = renderer.CreateLayout(materialLayoutInfo);
+	}
+
+	vi::PipelineLayoutInfo pipelineInfo{};
+	pipelineInfo.attributeDescriptions = Vertex::GetAttributeDescriptions();
+	for (const auto& attributeDescription : Vertex::GetInstanceAttributeDescriptions())
+		pipelineInfo.attributeDescriptions.push_back(attributeDescription);
+	pipelineInfo.bindingDescriptions.push_back(Vertex::GetBindingDescription());
+	pipelineInfo.bindingDescriptions.push_back(Vertex::GetInstanceBindingDescription());
+	pipelineInfo.setLayouts.push_back(cameraSystem.GetLayout());
+	pipelineInfo.setLayouts.push_back(layout);
+	pipelineInfo.modules.push_back(
+		{
+			_vertModule,
+			VK_SHADER_STAGE_VERTEX_BIT
+		});
+	pipelineInfo.modules.push_back(
+		{
+			_fragModule,
+			VK_SHADER_STAGE_FRAGMENT_BIT
+		});
+	pipelineInfo.renderPass = swapChain.GetRenderPass();
+	pipelineInfo.extent = swapChain.GetExtent();
+
+	_pipeline = renderer.CreatePipeline(pipelineInfo);
+
+	const uint32_t imageCount = swapChain.GetImageCount();
+	if (!_bindless)
+		_materialCache.Construct(layout, imageCount);
+	_instanceBuffers.resize(imageCount);
+
+	RenderThread::Instance::Get().AddPass([this](const uint32_t packetIndex)
+	{
+		Render(packetIndex);
+	});
+}
+
+template <typename Material, typename Frame, typename Vertex, typename Camera, typename Derived>
+void InstancedShaderSet<Material, Frame, Vertex, Camera, Derived>::Cleanup()
+{
+	ShaderSet<Material, Frame, Derived>::Cleanup();
+
+	auto& renderSystem = RenderSystem::Instance::Get();
+	auto& renderer = renderSystem.GetVkRenderer();
+
+	renderer.DestroyPipeline(_pipeline);
+	renderer.DestroyShaderModule(_vertModule);
+	renderer.DestroyShaderModule(_fragModule);
+	if (!_bindless)
+		_materialCache.Cleanup();
+
+	for (auto& instanceBuffer : _instanceBuffers)
+	{
+		if (instanceBuffer.capacity == 0)
+			continue;
+		renderer.DestroyBuffer(instanceBuffer.buffer);
+		renderer.FreeMemory(instanceBuffer.memory);
+	}
+}
+
+template <typename Material, typename Frame, typename Vertex, typename Camera, typename Derived>
+void InstancedShaderSet<Material, Frame, Vertex, Camera, Derived>::Update()
+{
+	ShaderSet<Material, Frame, Derived>::Update();
+
+	auto& renderThread = RenderThread::Instance::Get();
+	auto& cameraSystem = Camera::Instance::Get();
+
+	auto& packet = _packets[renderThread.GetPacketIndex()];
+	packet.cameraSet = VK_NULL_HANDLE;
+	packet.frameSlot = renderThread.GetFrameSlot();
+	packet.batches.clear();
+	packet.instances.clear();
+
+	// Follow changes to the material parameters.
+	if (!_bindless)
+	{
+		_materialCache.Update();
+		for (const auto [instance, sparseId] : *this)
+			if (!ShaderSet<Material, Frame, Derived>::IsErased(ce::SoASet<Material, Derived>::GetDenseId(sparseId)))
+				_materialCache.Assign(instance.material, { instance.diffuseTexture->imageView, instance.diffuseFilter });
+		_materialCache.Flush();
+	}
+
+	if (cameraSystem.GetSize() == 0)
+		return;
+
+	packet.cameraSet = cameraSystem.GetDescriptorSet();
+	ce::SoASet<Material, Derived>::GetDerived().FillPacket(packet);
+}
+
+template <typename Material, typename Frame, typename Vertex, typename Camera, typename Derived>
+void InstancedShaderSet<Material, Frame, Vertex, Camera, Derived>::ConstructInstances(const uint32_t denseId, const uint32_t count)
+{
+	// Instances inserted in bulk are copies, which share the parameters but not the reference.
+	// Single inserts start out without a material, so a handle that is held is never overwritten.
+	for (uint32_t i = denseId; i < denseId + count; ++i)
+		(*this)[ce::SoASet<Material, Derived>::GetSparseId(i)].material = MaterialCache::invalidHandle;
+
+	ShaderSet<Material, Frame, Derived>::ConstructInstances(denseId, count);
+}
+
+template <typename Material, typename Frame, typename Vertex, typename Camera, typename Derived>
+void InstancedShaderSet<Material, Frame, Vertex, Camera, Derived>::ReviveInstance(Material& material, const Material& value, const uint32_t)
+{
+	// Keep the reference the instance already holds, which Update moves to the new parameters.
+	const uint32_t handle = material.material;
+	material = value;
+	material.material = handle;
+}
+
+template <typename Material, typename Frame, typename Vertex, typename Camera, typename Derived>
+void InstancedShaderSet<Material, Frame, Vertex, Camera, Derived>::CleanupInstance(Material& material, const uint32_t)
+{
+	if (material.material != MaterialCache::invalidHandle)
+		_materialCache.Release(material.material);
+}
+
+template <typename Material, typename Frame, typename Vertex, typename Camera, typename Derived>
+void InstancedShaderSet<Material, Frame, Vertex, Camera, Derived>::Render(const uint32_t packetIndex)
+{
+	auto& renderSystem = RenderSystem::Instance::Get();
+	auto& renderer = renderSystem.GetVkRenderer();
+
+	const auto& packet = _packets[packetIndex];
+	if (packet.cameraSet == VK_NULL_HANDLE || packet.instances.empty())
+		return;
+
+	// The GPU is done with the frame slot once the frame has begun, so its instance buffer can be written to.
+	const auto instanceCount = static_cast<uint32_t>(packet.instances.size());
+	auto& instanceBuffer = _instanceBuffers[packet.frameSlot];
+	ReserveInstances(instanceBuffer, instanceCount);
+	memcpy(instanceBuffer.data, packet.instances.data(), sizeof(typename Vertex::Instance) * instanceCount);
+
+	// The camera set, followed by the material set.
+	VkDescriptorSet sets[2]{ packet.cameraSet, VK_NULL_HANDLE };
+
+	// The materials draw with the first camera.
+	auto& cameraSystem = Camera::Instance::Get();
+	const uint32_t cameraOffset = cameraSystem.GetUniformOffset(0);
+
+	renderer.BindPipeline(_pipeline);
+	renderer.BindVertexBuffer(instanceBuffer.buffer, 1);
+
+	// Bindless batches only differ in their meshes, so the sets are bound once for the whole pass.
+	if (_bindless)
+	{
+		sets[1] = renderSystem.GetBindlessSet();
+		renderer.BindDescriptorSets(sets, 2, &cameraOffset, 1);
+	}
+
+	for (const auto& batch : packet.batches)
+	{
+		renderer.BindVertexBuffer(batch.vertexBuffer);
+		renderer.BindIndicesBuffer(batch.indexBuffer);
+
+		if (!_bindless)
+		{
+			sets[1] = batch.descriptorSet;
+			renderer.BindDescriptorSets(sets, 2, &cameraOffset, 1);
+		}
+
+		renderer.Draw(batch.indCount, batch.instanceCount, batch.firstInstance);
+	}
+}
+
+template <typename Material, typename Frame, typename Vertex, typename Camera, typename Derived>
+void InstancedShaderSet<Material, Frame, Vertex, Camera, Derived>::ReserveInstances(InstanceBuffer& instanceBuffer, const uint32_t count) const
+{
+	if (count <= instanceBuffer.capacity)
+		return;
+
+	auto& renderSystem = RenderSystem::Instance::Get();
+	auto& renderer = renderSystem.GetVkRenderer();
+
+	if (instanceBuffer.capacity > 0)
+	{
+		renderer.DestroyBuffer(instanceBuffer.buffer);
+		renderer.FreeMemory(instanceBuffer.memory);
+	}
+
+	instanceBuffer.capacity = std::max(count, instanceBuffer.capacity * 2);
+	instanceBuffer.buffer = renderer.template CreateBuffer<typename Vertex::Instance>(instanceBuffer.capacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	instanceBuffer.memory = renderer.AllocateMemory(instanceBuffer.buffer,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	renderer.BindMemory(instanceBuffer.buffer, instanceBuffer.memory);
+	instanceBuffer.data = renderer.MapMemory(instanceBuffer.memory);
+}
\ No newline at end of file
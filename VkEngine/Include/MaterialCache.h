@@ -0,0 +1,83 @@
+﻿#pragma once
+#include <deque>
+#include <unordered_map>
+
+// Shares a descriptor set and a sampler between all the instances that use the same material parameters,
+// so that they scale with the number of unique materials instead of the number of instances.
+class MaterialCache final
+{
+public:
+	// The parameters that make a material unique.
+	struct Key final
+	{
+		VkImageView imageView = VK_NULL_HANDLE;
+		VkFilter filter = VK_FILTER_LINEAR;
+
+		[[nodiscard]] bool operator==(const Key& other) const;
+	};
+
+	struct Material final
+	{
+		Key key{};
+		// Written once by the flush after the material is created, so it can be bound by any frame after that.
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		VkSampler sampler = VK_NULL_HANDLE;
+		uint32_t refCount = 0;
+	};
+
+	struct Settings final
+	{
+		// Descriptor pools are added as needed, with room for this many materials each.
+		uint32_t poolSize = 64;
+	};
+
+	static constexpr uint32_t invalidHandle = UINT32_MAX;
+
+	// Takes ownership of the layout, which has a single combined image sampler binding.
+	void Construct(VkDescriptorSetLayout layout, uint32_t frameCount);
+	void Construct(VkDescriptorSetLayout layout, uint32_t frameCount, const Settings& settings);
+	void Cleanup();
+
+	// Reuses the materials that have been released long enough ago for the GPU to be done with them.
+	void Update();
+
+	[[nodiscard]] uint32_t Acquire(const Key& key);
+	void Release(uint32_t handle);
+	// Points the handle to the material with the given parameters, if it doesn't already.
+	void Assign(uint32_t& handle, const Key& key);
+	// Writes the descriptor sets of the materials created since the last flush in a single update.
+	// Has to be called before the frame that draws them is submitted to the render thread.
+	void Flush();
+
+	[[nodiscard]] const Material& operator[](uint32_t handle) const;
+	[[nodiscard]] uint32_t GetCount() const;
+
+private:
+	struct KeyHash final
+	{
+		[[nodiscard]] size_t operator()(const Key& key) const;
+	};
+
+	struct ReleasedMaterial final
+	{
+		uint32_t handle;
+		uint64_t frame;
+	};
+
+	Settings _settings;
+	VkDescriptorSetLayout _layout;
+	uint32_t _frameCount;
+	uint64_t _frame = 0;
+
+	std::vector<Material> _materials{};
+	std::unordered_map<Key, uint32_t, KeyHash> _handles{};
+	std::vector<uint32_t> _freeHandles{};
+	std::deque<ReleasedMaterial> _releasedMaterials{};
+
+	std::vector<VkDescriptorSet> _pendingSets{};
+	std::vector<VkImageView> _pendingImageViews{};
+	std::vector<VkSampler> _pendingSamplers{};
+
+	std::vector<VkDescriptorPool> _descriptorPools{};
+	uint32_t _remainingSetsInPool = 0;
+};
\ No newline at end of file
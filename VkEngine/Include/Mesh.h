@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include "Vertex2d.h"
 #include "Vertex3d.h"
+#include "VkRenderer/MemoryAllocator.h"
 
 struct Mesh final
 {
@@ -22,10 +23,18 @@ struct Mesh final
     };
 
     VkBuffer vertexBuffer;
-    VkDeviceMemory vertexMemory;
+    vi::Allocation vertexMemory;
     VkBuffer indexBuffer;
-    VkDeviceMemory indexMemory;
+    vi::Allocation indexMemory;
     uint32_t indCount;
+    // Ticket of the upload, see RenderSystem::IsReady.
+    uint64_t upload = 0;
+
+    // Local bounds of the vertices.
+    glm::vec3 boundsMin{};
+    glm::vec3 boundsMax{};
+    // Radius of the bounding sphere, centered on the bounding box.
+    float boundsRadius = 0;
 
     class System final : public ce::SparseSet<Mesh>
     {
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace ce
+{
+	// Captures the component values of a template entity, so that it can be cloned in bulk.
+	class Prefab final
+	{
+	public:
+		template <typename S>
+		void Capture(S& set, uint32_t sparseId);
+		template <typename S, typename T>
+		void Add(S& set, const T& value);
+
+		void Instantiate(const uint32_t* sparseIds, uint32_t count) const;
+
+	private:
+		std::vector<std::function<void(const uint32_t*, uint32_t)>> _instantiators{};
+	};
+
+	template <typename S>
+	void Prefab::Capture(S& set, const uint32_t sparseId)
+	{
+		Add(set, set[sparseId]);
+	}
+
+	template <typename S, typename T>
+	void Prefab::Add(S& set, const T& value)
+	{
+		_instantiators.push_back([&set, value](const uint32_t* sparseIds, const uint32_t count)
+		{
+			set.InsertRange(sparseIds, count, value);
+		});
+	}
+
+	inline void Prefab::Instantiate(const uint32_t* sparseIds, const uint32_t count) const
+	{
+		for (const auto& instantiator : _instantiators)
+			instantiator(sparseIds, count);
+	}
+}
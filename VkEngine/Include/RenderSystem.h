@@ -3,6 +3,8 @@
 #include "VkRenderer/SwapChain.h"
 #include "Mesh.h"
 #include "Texture.h"
+#include "UniformRing.h"
+#include "UploadManager.h"
 
 struct DepthBuffer;
 
@@ -16,83 +18,87 @@ class RenderSystem final
 public:
 	typedef Singleton<RenderSystem> Instance;
 
+	struct Settings final
+	{
+		// Puts all textures in a single update after bind array, which is indexed through the instance data.
+		bool bindlessTextures = false;
+		uint32_t maxBindlessTextures = 4096;
+		UploadManager::Settings uploads{};
+	};
+
 	RenderSystem();
+	explicit RenderSystem(const Settings& settings);
 	~RenderSystem();
 
-	void BeginFrame(bool* quit);
+	// Handles the window events, which has to happen on the main thread.
+	void PollEvents(bool* quit);
+	// Records a frame, which happens on the render thread.
+	void BeginFrame();
 	void EndFrame();
 
+	// Meshes and textures can be used right away, since their data is uploaded before the next frame is drawn.
+	// They can only be destroyed once they are ready, or once the device is idle after a frame has been recorded.
 	template <typename Vert = Vertex2d, typename Ind = uint16_t>
 	[[nodiscard]] Mesh CreateMesh(const std::vector<Vert>& vertices, const std::vector<Ind>& indices);
 	void UseMesh(const Mesh& mesh) const;
 	void DestroyMesh(const Mesh& mesh);
+	[[nodiscard]] bool IsReady(const Mesh& mesh) const;
 
 	[[nodiscard]] Texture CreateTexture(const std::string& fileName);
 	void DestroyTexture(const Texture& texture);
+	[[nodiscard]] bool IsReady(const Texture& texture) const;
 
+	// Records and submits commands through the renderer, so the render thread has to be flushed beforehand.
 	[[nodiscard]] DepthBuffer CreateDepthBuffer(glm::ivec2 resolution);
-	void DestroyDepthBuffer(DepthBuffer& depthBuffer) const;
+	void DestroyDepthBuffer(DepthBuffer& depthBuffer);
 
 	[[nodiscard]] vi::WindowSystemGLFW& GetWindowSystem() const;
 	[[nodiscard]] vi::VkRenderer& GetVkRenderer();
 	[[nodiscard]] vi::SwapChain& GetSwapChain();
+	// Uniform data for the frame that is being recorded, which can only be used on the render thread.
+	[[nodiscard]] UniformRing& GetUniformRing();
+
+	[[nodiscard]] bool IsBindless() const;
+	// The set containing all textures, which only has to be bound once per pass.
+	[[nodiscard]] VkDescriptorSetLayout GetBindlessLayout() const;
+	[[nodiscard]] VkDescriptorSet GetBindlessSet() const;
 
 private:
+	Settings _settings;
+
 	vi::WindowSystemGLFW* _windowSystem;
 	vi::VkRenderer _vkRenderer{};
 	vi::SwapChain _swapChain{};
+	UniformRing _uniformRing{};
+	UploadManager _uploads{};
 
 	VkRenderPass _renderPass;
 
 	vi::SwapChain::Image _image;
 	vi::SwapChain::Frame _frame;
+
+	VkDescriptorSetLayout _bindlessLayout = VK_NULL_HANDLE;
+	VkDescriptorPool _bindlessPool = VK_NULL_HANDLE;
+	VkDescriptorSet _bindlessSet = VK_NULL_HANDLE;
+	VkSampler _bindlessSampler = VK_NULL_HANDLE;
+	std::vector<uint32_t> _freeTextureIndices{};
+	uint32_t _textureIndexCount = 0;
 };
 
 template <typename Vert, typename Ind>
 Mesh RenderSystem::CreateMesh(const std::vector<Vert>& vertices, const std::vector<Ind>& indices)
 {
-	auto cpyCommandBuffer = _vkRenderer.CreateCommandBuffer();
-	const auto cpyFence = _vkRenderer.CreateFence();
-
-	// Send vertex data.
-	const auto vertStagingBuffer = _vkRenderer.CreateBuffer<Vert>(vertices.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-	const auto vertStagingMem = _vkRenderer.AllocateMemory(vertStagingBuffer,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	_vkRenderer.BindMemory(vertStagingBuffer, vertStagingMem);
-	_vkRenderer.MapMemory(vertStagingMem, vertices.data(), 0, vertices.size());
+	// Empty buffers can't be created, and the bounds would be left inverted.
+	assert(!vertices.empty() && !indices.empty());
 
 	const auto vertBuffer = _vkRenderer.CreateBuffer<Vert>(vertices.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
 	const auto vertMem = _vkRenderer.AllocateMemory(vertBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 	_vkRenderer.BindMemory(vertBuffer, vertMem);
 
-	// Send indices data.
-	const auto indStagingBuffer = _vkRenderer.CreateBuffer<Ind>(indices.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-	const auto indStagingMem = _vkRenderer.AllocateMemory(indStagingBuffer,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	_vkRenderer.BindMemory(indStagingBuffer, indStagingMem);
-	_vkRenderer.MapMemory(indStagingMem, indices.data(), 0, indices.size());
-
-	const auto indBuffer = _vkRenderer.CreateBuffer<Vert>(vertices.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+	const auto indBuffer = _vkRenderer.CreateBuffer<Ind>(indices.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 	const auto indMem = _vkRenderer.AllocateMemory(indBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 	_vkRenderer.BindMemory(indBuffer, indMem);
 
-	_vkRenderer.BeginCommandBufferRecording(cpyCommandBuffer);
-	_vkRenderer.CopyBuffer(vertStagingBuffer, vertBuffer, vertices.size() * sizeof(Vert));
-	_vkRenderer.CopyBuffer(indStagingBuffer, indBuffer, indices.size() * sizeof(Ind));
-	_vkRenderer.EndCommandBufferRecording();
-
-	_vkRenderer.Submit(&cpyCommandBuffer, 1, VK_NULL_HANDLE, VK_NULL_HANDLE, cpyFence);
-	_vkRenderer.WaitForFence(cpyFence);
-
-	_vkRenderer.DestroyBuffer(vertStagingBuffer);
-	_vkRenderer.FreeMemory(vertStagingMem);
-
-	_vkRenderer.DestroyBuffer(indStagingBuffer);
-	_vkRenderer.FreeMemory(indStagingMem);
-
-	_vkRenderer.DestroyFence(cpyFence);
-	_vkRenderer.DestroyCommandBuffer(cpyCommandBuffer);
-
 	Mesh mesh{};
 	mesh.vertexBuffer = vertBuffer;
 	mesh.vertexMemory = vertMem;
@@ -100,5 +106,33 @@ Mesh RenderSystem::CreateMesh(const std::vector<Vert>& vertices, const std::vect
 	mesh.indexMemory = indMem;
 	mesh.indCount = indices.size();
 
+	// Tickets complete in order, so the last one covers the whole mesh.
+	mesh.upload = _uploads.Upload(vertBuffer, vertices.data(), vertices.size() * sizeof(Vert));
+	mesh.upload = _uploads.Upload(indBuffer, indices.data(), indices.size() * sizeof(Ind));
+
+	constexpr int32_t dimensions = decltype(Vert::position)::length();
+
+	mesh.boundsMin = glm::vec3(FLT_MAX);
+	mesh.boundsMax = glm::vec3(-FLT_MAX);
+	for (const auto& vertex : vertices)
+		for (int32_t i = 0; i < dimensions; ++i)
+		{
+			mesh.boundsMin[i] = std::min(mesh.boundsMin[i], vertex.position[i]);
+			mesh.boundsMax[i] = std::max(mesh.boundsMax[i], vertex.position[i]);
+		}
+
+	// 2D meshes are flat.
+	for (int32_t i = dimensions; i < 3; ++i)
+		mesh.boundsMin[i] = mesh.boundsMax[i] = 0;
+
+	const glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * .5f;
+	for (const auto& vertex : vertices)
+	{
+		glm::vec3 offset = -center;
+		for (int32_t i = 0; i < dimensions; ++i)
+			offset[i] += vertex.position[i];
+		mesh.boundsRadius = std::max(mesh.boundsRadius, glm::length(offset));
+	}
+
 	return mesh;
 }
@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Records and submits the frames on a separate thread, one frame behind the simulation.
+// Systems fill a packet on the simulation thread, and record it in a pass on the render thread.
+class RenderThread final
+{
+public:
+	typedef Singleton<RenderThread> Instance;
+	typedef std::function<void(uint32_t packetIndex)> Pass;
+
+	// Every system needs this many packets, one that is being filled and one that is being recorded.
+	static constexpr uint32_t packetCount = 2;
+
+	RenderThread();
+	~RenderThread();
+
+	// Passes are recorded in the order they have been added, which has to happen before the first frame is submitted.
+	void AddPass(const Pass& pass);
+
+	// Waits for the render thread to finish the previous frame, and hands it the packets that have been filled.
+	void Submit();
+	// Waits until every submitted frame has been recorded and submitted.
+	void Flush();
+
+	// The packet that is being filled by the simulation.
+	[[nodiscard]] uint32_t GetPacketIndex() const;
+	// The per instance frame resources used by the packet that is being filled.
+	// A slot is only reused after the GPU is done with it, since there are never more frames in flight than swap chain images.
+	[[nodiscard]] uint32_t GetFrameSlot() const;
+
+private:
+	std::thread _thread;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::vector<Pass> _passes{};
+
+	uint64_t _submittedFrames = 0;
+	uint64_t _renderedFrames = 0;
+	bool _quit = false;
+
+	void Run();
+};
@@ -1,155 +1,288 @@
 ﻿#pragma once
 #include "SoASet.h"
 #include "RenderSystem.h"
+#include "RenderThread.h"
+#include "BudgetScheduler.h"
+#include <deque>
 
-template <typename Material, typename Frame>
-class ShaderSet : public ce::SoASet<Material>
+// Derived can hide the instance hooks below, which are resolved at compile time so they can be inlined in the per instance loops.
+template <typename Material, typename Frame, typename Derived>
+class ShaderSet : public ce::SoASet<Material, Derived>
 {
 public:
-	explicit ShaderSet(uint32_t size);
+	explicit ShaderSet(uint32_t size, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 	virtual void Cleanup();
 
-	Material& Insert(uint32_t sparseId) override;
+	Material& Insert(uint32_t sparseId);
+	void InsertRange(const uint32_t* sparseIds, uint32_t count, const Material& material);
 	void Erase(uint32_t sparseId) override;
 
-	virtual void ConstructInstance(Material& material, uint32_t denseId);
-	virtual void CleanupInstance(Material& material, uint32_t denseId);
-	virtual void ConstructInstanceFrame(Frame& frame, Material& material, uint32_t denseId);
-	virtual void CleanupInstanceFrame(Frame& frame, Material& material, uint32_t denseId);
+	void ConstructInstance(Material& material, uint32_t denseId);
+	// Called for erased instances that are inserted in bulk again before they have been cleaned up, which still own their resources.
+	void ReviveInstance(Material& material, const Material& value, uint32_t denseId);
+	// Called once for instances that are inserted in bulk, which can be hidden to batch GPU resource creation.
+	void ConstructInstances(uint32_t denseId, uint32_t count);
+	void CleanupInstance(Material& material, uint32_t denseId);
+	void ConstructInstanceFrame(Frame& frame, Material& material, uint32_t denseId);
+	void CleanupInstanceFrame(Frame& frame, Material& material, uint32_t denseId);
 
 	virtual void Update();
+	// Cleans up to maxCount erased instances that are no longer in use, and returns true while there are more.
+	bool CleanupErased(uint32_t maxCount);
 
-	[[nodiscard]] typename ce::SoASet<Material>::SubSet GetCurrentFrameSet();
+	// The frame resources for the packet that is being filled.
+	[[nodiscard]] typename ce::SoASet<Material, Derived>::SubSet GetCurrentFrameSet();
+	// Erased instances are kept around until the render thread and the GPU are done with them, but should no longer be drawn.
+	[[nodiscard]] bool IsErased(uint32_t denseId);
 
 private:
-	std::vector<uint32_t> _erasableIds{};
+	struct ErasedInstance final
+	{
+		uint32_t sparseId;
+		uint64_t frame;
+	};
+
+	static constexpr uint32_t cleanupStepSize = 16;
+
+	uint64_t _frame = 0;
+	uint32_t _cleanupTask;
+	std::deque<ErasedInstance> _erasedInstances{};
+	std::vector<uint32_t> _insertIds{};
+
+	// Returns true when the instance was waiting to be cleaned up, after which it no longer is.
+	bool Revive(uint32_t sparseId);
+	void CleanupInstanceFrames(Material& material, uint32_t denseId);
 };
 
-template <typename Material, typename Frame>
-ShaderSet<Material, Frame>::ShaderSet(const uint32_t size) : ce::SoASet<Material>(size)
+template <typename Material, typename Frame, typename Derived>
+ShaderSet<Material, Frame, Derived>::ShaderSet(const uint32_t size, std::pmr::memory_resource* resource) :
+	ce::SoASet<Material, Derived>(size, resource)
 {
 	auto& renderSystem = RenderSystem::Instance::Get();
 	auto& swapChain = renderSystem.GetSwapChain();
 
-	ce::SoASet<Material>::template AddSubSet<int8_t>();
+	ce::SoASet<Material, Derived>::template AddSubSet<int8_t>();
 
 	const uint32_t imageCount = swapChain.GetImageCount();
 	for (uint32_t i = 0; i < imageCount; ++i)
-		ce::SoASet<Material>::template AddSubSet<Frame>();
+		ce::SoASet<Material, Derived>::template AddSubSet<Frame>();
+
+	auto& scheduler = BudgetScheduler::Instance::Get();
+	_cleanupTask = scheduler.Add(typeid(Material).name(), [this]
+	{
+		return CleanupErased(cleanupStepSize);
+	});
 }
 
-template <typename Material, typename Frame>
-void ShaderSet<Material, Frame>::Cleanup()
+template <typename Material, typename Frame, typename Derived>
+void ShaderSet<Material, Frame, Derived>::Cleanup()
 {
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& swapChain = renderSystem.GetSwapChain();
-
-	const uint32_t imageCount = swapChain.GetImageCount();
-	auto& sets = ce::SoASet<Material>::GetSets();
+	// The task points to this set, so it can't outlive it.
+	auto& scheduler = BudgetScheduler::Instance::Get();
+	scheduler.Remove(_cleanupTask);
 
 	for (const auto [instance, sparseId] : *this)
 	{
-		const uint32_t denseId = ce::SoASet<Material>::GetDenseId(sparseId);
-		CleanupInstance(instance, denseId);
-
-		for (uint32_t i = 1; i < imageCount + 1; ++i)
-			CleanupInstanceFrame(sets[i].template Get<Frame>(denseId), instance, denseId);
+		const uint32_t denseId = ce::SoASet<Material, Derived>::GetDenseId(sparseId);
+		CleanupInstanceFrames(instance, denseId);
 	}
 }
 
-template <typename Material, typename Frame>
-Material& ShaderSet<Material, Frame>::Insert(const uint32_t sparseId)
+template <typename Material, typename Frame, typename Derived>
+Material& ShaderSet<Material, Frame, Derived>::Insert(const uint32_t sparseId)
 {
 	auto& renderSystem = RenderSystem::Instance::Get();
 	auto& swapChain = renderSystem.GetSwapChain();
-	auto& material = ce::SoASet<Material>::Insert(sparseId);
-	auto& deleteQueue = ce::SoASet<Material>::GetSets()[0];
-	const uint32_t denseId = ce::SoASet<Material>::GetDenseId(sparseId);
+	auto& deleteQueue = ce::SoASet<Material, Derived>::GetSets()[0];
+
+	// The instance still owns its resources, even when it is waiting to be cleaned up.
+	if (ce::SoASet<Material, Derived>::Contains(sparseId))
+	{
+		Revive(sparseId);
+		return (*this)[sparseId];
+	}
 
+	auto& material = ce::SoASet<Material, Derived>::Insert(sparseId);
+	const uint32_t denseId = ce::SoASet<Material, Derived>::GetDenseId(sparseId);
+
+	auto& derived = ce::SoASet<Material, Derived>::GetDerived();
 	deleteQueue.template Get<int8_t>(denseId) = -1;
-	ConstructInstance(material, denseId);
+	derived.ConstructInstance(material, denseId);
 
 	const uint32_t imageCount = swapChain.GetImageCount();
-	auto& sets = ce::SoASet<Material>::GetSets();
+	auto& sets = ce::SoASet<Material, Derived>::GetSets();
 
 	for (uint32_t i = 1; i < imageCount + 1; ++i)
-		ConstructInstanceFrame(sets[i].template Get<Frame>(denseId), material, denseId);
+		derived.ConstructInstanceFrame(sets[i].template Get<Frame>(denseId), material, denseId);
 
 	return material;
 }
 
-template <typename Material, typename Frame>
-void ShaderSet<Material, Frame>::Erase(const uint32_t sparseId)
+template <typename Material, typename Frame, typename Derived>
+void ShaderSet<Material, Frame, Derived>::InsertRange(const uint32_t* sparseIds, const uint32_t count, const Material& material)
+{
+	auto& derived = ce::SoASet<Material, Derived>::GetDerived();
+
+	// Entities can be reused before their erased instances are cleaned up, which are then revived instead of appended.
+	_insertIds.clear();
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t sparseId = sparseIds[i];
+		if (!ce::SoASet<Material, Derived>::Contains(sparseId))
+		{
+			_insertIds.push_back(sparseId);
+			continue;
+		}
+
+		const bool revived = Revive(sparseId);
+		assert(revived);
+		derived.ReviveInstance((*this)[sparseId], material, ce::SoASet<Material, Derived>::GetDenseId(sparseId));
+	}
+
+	const uint32_t denseId = ce::SoASet<Material, Derived>::GetCount();
+	const auto insertCount = static_cast<uint32_t>(_insertIds.size());
+	ce::SoASet<Material, Derived>::InsertRange(_insertIds.data(), insertCount, material);
+
+	auto& deleteQueue = ce::SoASet<Material, Derived>::GetSets()[0];
+	memset(&deleteQueue.template Get<int8_t>(denseId), -1, insertCount);
+
+	derived.ConstructInstances(denseId, insertCount);
+}
+
+template <typename Material, typename Frame, typename Derived>
+void ShaderSet<Material, Frame, Derived>::Erase(const uint32_t sparseId)
 {
 	auto& renderSystem = RenderSystem::Instance::Get();
 	auto& swapChain = renderSystem.GetSwapChain();
 
-	auto& deleteQueue = ce::SoASet<Material>::GetSets()[0];
-	deleteQueue.template Get<int8_t>(ce::SoASet<Material>::GetDenseId(sparseId)) = swapChain.GetImageCount();
+	auto& deleteQueue = ce::SoASet<Material, Derived>::GetSets()[0];
+	auto& erased = deleteQueue.template Get<int8_t>(ce::SoASet<Material, Derived>::GetDenseId(sparseId));
+	if (erased != -1)
+		return;
+	erased = 1;
+
+	// The render thread is a frame behind, so wait a frame longer than there are images in flight.
+	_erasedInstances.push_back({ sparseId, _frame + swapChain.GetImageCount() + 2 });
 }
 
-template <typename Material, typename Frame>
-void ShaderSet<Material, Frame>::ConstructInstance(Material& material, const uint32_t denseId)
+template <typename Material, typename Frame, typename Derived>
+void ShaderSet<Material, Frame, Derived>::ConstructInstance(Material& material, const uint32_t denseId)
 {
 }
 
-template <typename Material, typename Frame>
-void ShaderSet<Material, Frame>::CleanupInstance(Material& material, const uint32_t denseId)
+template <typename Material, typename Frame, typename Derived>
+void ShaderSet<Material, Frame, Derived>::ReviveInstance(Material& material, const Material& value, const uint32_t denseId)
 {
+	material = value;
 }
 
-template <typename Material, typename Frame>
-void ShaderSet<Material, Frame>::ConstructInstanceFrame(Frame& frame, Material& material, const uint32_t denseId)
+template <typename Material, typename Frame, typename Derived>
+void ShaderSet<Material, Frame, Derived>::ConstructInstances(const uint32_t denseId, const uint32_t count)
 {
+	auto& renderSystem = RenderSystem::Instance::Get();
+	auto& swapChain = renderSystem.GetSwapChain();
+	auto& derived = ce::SoASet<Material, Derived>::GetDerived();
+
+	const uint32_t imageCount = swapChain.GetImageCount();
+	auto& sets = ce::SoASet<Material, Derived>::GetSets();
+
+	for (uint32_t i = denseId; i < denseId + count; ++i)
+	{
+		auto& material = (*this)[ce::SoASet<Material, Derived>::GetSparseId(i)];
+		derived.ConstructInstance(material, i);
+
+		for (uint32_t j = 1; j < imageCount + 1; ++j)
+			derived.ConstructInstanceFrame(sets[j].template Get<Frame>(i), material, i);
+	}
 }
 
-template <typename Material, typename Frame>
-void ShaderSet<Material, Frame>::CleanupInstanceFrame(Frame& frame, Material& material, const uint32_t denseId)
+template <typename Material, typename Frame, typename Derived>
+void ShaderSet<Material, Frame, Derived>::CleanupInstance(Material& material, const uint32_t denseId)
 {
 }
 
-template <typename Material, typename Frame>
-void ShaderSet<Material, Frame>::Update()
+template <typename Material, typename Frame, typename Derived>
+void ShaderSet<Material, Frame, Derived>::ConstructInstanceFrame(Frame& frame, Material& material, const uint32_t denseId)
 {
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& swapChain = renderSystem.GetSwapChain();
+}
 
-	const uint32_t imageCount = swapChain.GetImageCount();
-	auto& sets = ce::SoASet<Material>::GetSets();
-	auto deleteQueue = ce::SoASet<Material>::GetSets()[0].template Get<int8_t>();
+template <typename Material, typename Frame, typename Derived>
+void ShaderSet<Material, Frame, Derived>::CleanupInstanceFrame(Frame& frame, Material& material, const uint32_t denseId)
+{
+}
 
-	_erasableIds.clear();
+template <typename Material, typename Frame, typename Derived>
+void ShaderSet<Material, Frame, Derived>::Update()
+{
+	_frame++;
+}
 
-	for (const auto [instance, sparseId] : *this)
+template <typename Material, typename Frame, typename Derived>
+bool ShaderSet<Material, Frame, Derived>::CleanupErased(const uint32_t maxCount)
+{
+	// Instances are erased in order, so the front of the queue is always the first one to be safe to clean up.
+	for (uint32_t i = 0; i < maxCount; ++i)
 	{
-		const uint32_t denseId = ce::SoASet<Material>::GetDenseId(sparseId);
+		if (_erasedInstances.empty() || _erasedInstances.front().frame > _frame)
+			return false;
 
-		auto& countdown = deleteQueue[denseId];
-		if (countdown == -1)
-			continue;
+		const uint32_t sparseId = _erasedInstances.front().sparseId;
+		_erasedInstances.pop_front();
 
-		if (countdown-- > 0)
+		// Skip instances that have been inserted again since.
+		if (!ce::SoASet<Material, Derived>::Contains(sparseId) || !IsErased(ce::SoASet<Material, Derived>::GetDenseId(sparseId)))
 			continue;
 
-		CleanupInstance(instance, denseId);
+		CleanupInstanceFrames((*this)[sparseId], ce::SoASet<Material, Derived>::GetDenseId(sparseId));
+		ce::SoASet<Material, Derived>::Erase(sparseId);
+	}
 
-		for (uint32_t i = 1; i < imageCount + 1; ++i)
-			CleanupInstanceFrame(sets[i].template Get<Frame>(denseId), instance, denseId);
+	return !_erasedInstances.empty() && _erasedInstances.front().frame <= _frame;
+}
 
-		_erasableIds.push_back(sparseId);
-	}
+template <typename Material, typename Frame, typename Derived>
+typename ce::SoASet<Material, Derived>::SubSet ShaderSet<Material, Frame, Derived>::GetCurrentFrameSet()
+{
+	auto& renderThread = RenderThread::Instance::Get();
+	auto& sets = ce::SoASet<Material, Derived>::GetSets();
+
+	return sets[renderThread.GetFrameSlot() + 1];
+}
 
-	for (const auto& id : _erasableIds)
-		ce::SoASet<Material>::Erase(id);
+template <typename Material, typename Frame, typename Derived>
+bool ShaderSet<Material, Frame, Derived>::IsErased(const uint32_t denseId)
+{
+	return ce::SoASet<Material, Derived>::GetSets()[0].template Get<int8_t>(denseId) != -1;
 }
 
-template <typename Material, typename Frame>
-typename ce::SoASet<Material>::SubSet ShaderSet<Material, Frame>::GetCurrentFrameSet()
+template <typename Material, typename Frame, typename Derived>
+bool ShaderSet<Material, Frame, Derived>::Revive(const uint32_t sparseId)
+{
+	auto& deleteQueue = ce::SoASet<Material, Derived>::GetSets()[0];
+	auto& erased = deleteQueue.template Get<int8_t>(ce::SoASet<Material, Derived>::GetDenseId(sparseId));
+	if (erased == -1)
+		return false;
+
+	erased = -1;
+	_erasedInstances.erase(std::find_if(_erasedInstances.begin(), _erasedInstances.end(), [sparseId](const ErasedInstance& instance)
+	{
+		return instance.sparseId == sparseId;
+	}));
+	return true;
+}
+
+template <typename Material, typename Frame, typename Derived>
+void ShaderSet<Material, Frame, Derived>::CleanupInstanceFrames(Material& material, const uint32_t denseId)
 {
 	auto& renderSystem = RenderSystem::Instance::Get();
 	auto& swapChain = renderSystem.GetSwapChain();
-	auto& sets = ce::SoASet<Material>::GetSets();
+	auto& derived = ce::SoASet<Material, Derived>::GetDerived();
 
-	return sets[swapChain.GetCurrentImageIndex() + 1];
-}
+	const uint32_t imageCount = swapChain.GetImageCount();
+	auto& sets = ce::SoASet<Material, Derived>::GetSets();
 
+	derived.CleanupInstance(material, denseId);
+
+	for (uint32_t i = 1; i < imageCount + 1; ++i)
+		derived.CleanupInstanceFrame(sets[i].template Get<Frame>(denseId), material, denseId);
+}
@@ -0,0 +1,398 @@
+﻿#pragma once
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// Thin wrappers around the available vector instructions, with a scalar fallback.
+namespace simd
+{
+	struct Float4 final
+	{
+		static constexpr uint32_t width = 4;
+
+#if defined(SIMD_SSE)
+		__m128 v;
+#elif defined(SIMD_NEON)
+		float32x4_t v;
+#else
+		float v[4];
+#endif
+
+		[[nodiscard]] static Float4 Splat(float f);
+		[[nodiscard]] static Float4 Load(const float* src);
+		// Loads every stride-th float, which reads a member from an array of structs.
+		[[nodiscard]] static Float4 Gather(const float* src, uint32_t stride);
+		void Store(float* dst) const;
+		[[nodiscard]] static Float4 Floor(Float4 a);
+	};
+
+	[[nodiscard]] Float4 operator+(Float4 a, Float4 b);
+	[[nodiscard]] Float4 operator-(Float4 a, Float4 b);
+	[[nodiscard]] Float4 operator*(Float4 a, Float4 b);
+	[[nodiscard]] Float4 operator/(Float4 a, Float4 b);
+	[[nodiscard]] Float4 Min(Float4 a, Float4 b);
+	[[nodiscard]] Float4 Max(Float4 a, Float4 b);
+	// Negates the lanes of a where b is negative.
+	[[nodiscard]] Float4 MulSign(Float4 a, Float4 b);
+	// Returns a bit for every lane where a is smaller than b.
+	[[nodiscard]] uint32_t LessThan(Float4 a, Float4 b);
+
+#if defined(__AVX2__)
+	struct Float8 final
+	{
+		static constexpr uint32_t width = 8;
+
+		__m256 v;
+
+		[[nodiscard]] static Float8 Splat(float f);
+		[[nodiscard]] static Float8 Load(const float* src);
+		[[nodiscard]] static Float8 Gather(const float* src, uint32_t stride);
+		void Store(float* dst) const;
+		[[nodiscard]] static Float8 Floor(Float8 a);
+	};
+
+	[[nodiscard]] Float8 operator+(Float8 a, Float8 b);
+	[[nodiscard]] Float8 operator-(Float8 a, Float8 b);
+	[[nodiscard]] Float8 operator*(Float8 a, Float8 b);
+	[[nodiscard]] Float8 operator/(Float8 a, Float8 b);
+	[[nodiscard]] Float8 Min(Float8 a, Float8 b);
+	[[nodiscard]] Float8 Max(Float8 a, Float8 b);
+	[[nodiscard]] Float8 MulSign(Float8 a, Float8 b);
+	[[nodiscard]] uint32_t LessThan(Float8 a, Float8 b);
+
+	// The widest vector supported by the target.
+	typedef Float8 Float;
+#else
+	typedef Float4 Float;
+#endif
+
+	// Computes the sine and cosine of every lane, with a precision close to std::sin and std::cos for moderate angles.
+	template <typename V>
+	void SinCos(V x, V& sin, V& cos);
+
+#if defined(SIMD_SSE)
+	inline Float4 Float4::Splat(const float f)
+	{
+		return { _mm_set1_ps(f) };
+	}
+
+	inline Float4 Float4::Load(const float* src)
+	{
+		return { _mm_loadu_ps(src) };
+	}
+
+	inline Float4 Float4::Gather(const float* src, const uint32_t stride)
+	{
+		return { _mm_setr_ps(src[0], src[stride], src[stride * 2], src[stride * 3]) };
+	}
+
+	inline void Float4::Store(float* dst) const
+	{
+		_mm_storeu_ps(dst, v);
+	}
+
+	inline Float4 Float4::Floor(const Float4 a)
+	{
+		// SSE2 has no floor, so truncate and correct the negative values.
+		const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+		return { _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1))) };
+	}
+
+	inline Float4 operator+(const Float4 a, const Float4 b)
+	{
+		return { _mm_add_ps(a.v, b.v) };
+	}
+
+	inline Float4 operator-(const Float4 a, const Float4 b)
+	{
+		return { _mm_sub_ps(a.v, b.v) };
+	}
+
+	inline Float4 operator*(const Float4 a, const Float4 b)
+	{
+		return { _mm_mul_ps(a.v, b.v) };
+	}
+
+	inline Float4 operator/(const Float4 a, const Float4 b)
+	{
+		return { _mm_div_ps(a.v, b.v) };
+	}
+
+	inline Float4 Min(const Float4 a, const Float4 b)
+	{
+		return { _mm_min_ps(a.v, b.v) };
+	}
+
+	inline Float4 Max(const Float4 a, const Float4 b)
+	{
+		return { _mm_max_ps(a.v, b.v) };
+	}
+
+	inline Float4 MulSign(const Float4 a, const Float4 b)
+	{
+		return { _mm_xor_ps(a.v, _mm_and_ps(b.v, _mm_set1_ps(-0.f))) };
+	}
+
+	inline uint32_t LessThan(const Float4 a, const Float4 b)
+	{
+		return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v));
+	}
+#elif defined(SIMD_NEON)
+	inline Float4 Float4::Splat(const float f)
+	{
+		return { vdupq_n_f32(f) };
+	}
+
+	inline Float4 Float4::Load(const float* src)
+	{
+		return { vld1q_f32(src) };
+	}
+
+	inline Float4 Float4::Gather(const float* src, const uint32_t stride)
+	{
+		const float lanes[] = { src[0], src[stride], src[stride * 2], src[stride * 3] };
+		return { vld1q_f32(lanes) };
+	}
+
+	inline void Float4::Store(float* dst) const
+	{
+		vst1q_f32(dst, v);
+	}
+
+	inline Float4 Float4::Floor(const Float4 a)
+	{
+		const float32x4_t t = vcvtq_f32_s32(vcvtq_s32_f32(a.v));
+		const uint32x4_t greater = vcgtq_f32(t, a.v);
+		return { vsubq_f32(t, vreinterpretq_f32_u32(vandq_u32(greater, vreinterpretq_u32_f32(vdupq_n_f32(1))))) };
+	}
+
+	inline Float4 operator+(const Float4 a, const Float4 b)
+	{
+		return { vaddq_f32(a.v, b.v) };
+	}
+
+	inline Float4 operator-(const Float4 a, const Float4 b)
+	{
+		return { vsubq_f32(a.v, b.v) };
+	}
+
+	inline Float4 operator*(const Float4 a, const Float4 b)
+	{
+		return { vmulq_f32(a.v, b.v) };
+	}
+
+	inline Float4 operator/(const Float4 a, const Float4 b)
+	{
+		// Not every NEON target can divide, so refine the reciprocal estimate twice instead.
+		float32x4_t reciprocal = vrecpeq_f32(b.v);
+		reciprocal = vmulq_f32(vrecpsq_f32(b.v, reciprocal), reciprocal);
+		reciprocal = vmulq_f32(vrecpsq_f32(b.v, reciprocal), reciprocal);
+		return { vmulq_f32(a.v, reciprocal) };
+	}
+
+	inline Float4 Min(const Float4 a, const Float4 b)
+	{
+		return { vminq_f32(a.v, b.v) };
+	}
+
+	inline Float4 Max(const Float4 a, const Float4 b)
+	{
+		return { vmaxq_f32(a.v, b.v) };
+	}
+
+	inline Float4 MulSign(const Float4 a, const Float4 b)
+	{
+		const uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(b.v), vdupq_n_u32(0x80000000));
+		return { vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a.v), sign)) };
+	}
+
+	inline uint32_t LessThan(const Float4 a, const Float4 b)
+	{
+		const uint32_t bits[] = { 1, 2, 4, 8 };
+		const uint32x4_t mask = vandq_u32(vcltq_f32(a.v, b.v), vld1q_u32(bits));
+		const uint32x2_t sum = vadd_u32(vget_low_u32(mask), vget_high_u32(mask));
+		return vget_lane_u32(vpadd_u32(sum, sum), 0);
+	}
+#else
+	inline Float4 Float4::Splat(const float f)
+	{
+		return { { f, f, f, f } };
+	}
+
+	inline Float4 Float4::Load(const float* src)
+	{
+		return { { src[0], src[1], src[2], src[3] } };
+	}
+
+	inline Float4 Float4::Gather(const float* src, const uint32_t stride)
+	{
+		return { { src[0], src[stride], src[stride * 2], src[stride * 3] } };
+	}
+
+	inline void Float4::Store(float* dst) const
+	{
+		for (uint32_t i = 0; i < width; ++i)
+			dst[i] = v[i];
+	}
+
+	inline Float4 Float4::Floor(const Float4 a)
+	{
+		return { { std::floor(a.v[0]), std::floor(a.v[1]), std::floor(a.v[2]), std::floor(a.v[3]) } };
+	}
+
+	inline Float4 operator+(const Float4 a, const Float4 b)
+	{
+		return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } };
+	}
+
+	inline Float4 operator-(const Float4 a, const Float4 b)
+	{
+		return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } };
+	}
+
+	inline Float4 operator*(const Float4 a, const Float4 b)
+	{
+		return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } };
+	}
+
+	inline Float4 operator/(const Float4 a, const Float4 b)
+	{
+		return { { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } };
+	}
+
+	inline Float4 Min(const Float4 a, const Float4 b)
+	{
+		Float4 result;
+		for (uint32_t i = 0; i < Float4::width; ++i)
+			result.v[i] = b.v[i] < a.v[i] ? b.v[i] : a.v[i];
+		return result;
+	}
+
+	inline Float4 Max(const Float4 a, const Float4 b)
+	{
+		Float4 result;
+		for (uint32_t i = 0; i < Float4::width; ++i)
+			result.v[i] = a.v[i] < b.v[i] ? b.v[i] : a.v[i];
+		return result;
+	}
+
+	inline Float4 MulSign(const Float4 a, const Float4 b)
+	{
+		Float4 result;
+		for (uint32_t i = 0; i < Float4::width; ++i)
+			result.v[i] = std::signbit(b.v[i]) ? -a.v[i] : a.v[i];
+		return result;
+	}
+
+	inline uint32_t LessThan(const Float4 a, const Float4 b)
+	{
+		uint32_t mask = 0;
+		for (uint32_t i = 0; i < Float4::width; ++i)
+			mask |= static_cast<uint32_t>(a.v[i] < b.v[i]) << i;
+		return mask;
+	}
+#endif
+
+#if defined(__AVX2__)
+	inline Float8 Float8::Splat(const float f)
+	{
+		return { _mm256_set1_ps(f) };
+	}
+
+	inline Float8 Float8::Load(const float* src)
+	{
+		return { _mm256_loadu_ps(src) };
+	}
+
+	inline Float8 Float8::Gather(const float* src, const uint32_t stride)
+	{
+		const __m256i indices = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+		return { _mm256_i32gather_ps(src, indices, sizeof(float)) };
+	}
+
+	inline void Float8::Store(float* dst) const
+	{
+		_mm256_storeu_ps(dst, v);
+	}
+
+	inline Float8 Float8::Floor(const Float8 a)
+	{
+		return { _mm256_floor_ps(a.v) };
+	}
+
+	inline Float8 operator+(const Float8 a, const Float8 b)
+	{
+		return { _mm256_add_ps(a.v, b.v) };
+	}
+
+	inline Float8 operator-(const Float8 a, const Float8 b)
+	{
+		return { _mm256_sub_ps(a.v, b.v) };
+	}
+
+	inline Float8 operator*(const Float8 a, const Float8 b)
+	{
+		return { _mm256_mul_ps(a.v, b.v) };
+	}
+
+	inline Float8 operator/(const Float8 a, const Float8 b)
+	{
+		return { _mm256_div_ps(a.v, b.v) };
+	}
+
+	inline Float8 Min(const Float8 a, const Float8 b)
+	{
+		return { _mm256_min_ps(a.v, b.v) };
+	}
+
+	inline Float8 Max(const Float8 a, const Float8 b)
+	{
+		return { _mm256_max_ps(a.v, b.v) };
+	}
+
+	inline Float8 MulSign(const Float8 a, const Float8 b)
+	{
+		return { _mm256_xor_ps(a.v, _mm256_and_ps(b.v, _mm256_set1_ps(-0.f))) };
+	}
+
+	inline uint32_t LessThan(const Float8 a, const Float8 b)
+	{
+		return _mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ));
+	}
+#endif
+
+	template <typename V>
+	void SinCos(const V x, V& sin, V& cos)
+	{
+		// Reduce to [-pi/4, pi/4] around the nearest multiple of pi/2, in three steps to keep the precision.
+		const V k = V::Floor(x * V::Splat(0.63661977236f) + V::Splat(.5f));
+		const V r = x - k * V::Splat(1.5703125f) - k * V::Splat(4.837512969970703125e-4f) - k * V::Splat(7.54978995489188216e-8f);
+		const V z = r * r;
+
+		const V sinPoly = ((V::Splat(-1.9515295891e-4f) * z + V::Splat(8.3321608736e-3f)) * z +
+			V::Splat(-1.6666654611e-1f)) * z * r + r;
+		const V cosPoly = ((V::Splat(2.443315711809948e-5f) * z + V::Splat(-1.388731625493765e-3f)) * z +
+			V::Splat(4.166664568298827e-2f)) * z * z - V::Splat(.5f) * z + V::Splat(1);
+
+		// Select the quadrant without branches or masks, where odd quadrants swap the polynomials.
+		const V half = V::Floor(k * V::Splat(.5f));
+		const V odd = k - half * V::Splat(2);
+		const V sinNegative = half - V::Floor(k * V::Splat(.25f)) * V::Splat(2);
+		const V cosNegative = odd + sinNegative - V::Splat(2) * odd * sinNegative;
+
+		const V one = V::Splat(1);
+		const V two = V::Splat(2);
+		sin = (sinPoly + odd * (cosPoly - sinPoly)) * (one - two * sinNegative);
+		cos = (cosPoly + odd * (sinPoly - cosPoly)) * (one - two * cosNegative);
+	}
+}
@@ -3,8 +3,8 @@
 
 namespace ce
 {
-	template <typename T>
-	class SoASet : public SparseSet<T>
+	template <typename T, typename Derived = void>
+	class SoASet : public SparseSet<T, CrtpType<SoASet<T, Derived>, Derived>>
 	{
 	public:
 		struct SubSet final
@@ -19,14 +19,15 @@ namespace ce
 		private:
 			char* _data;
 			size_t _unitSize;
+			size_t _alignment;
 		};
 
-		explicit SoASet(uint32_t size);
+		explicit SoASet(uint32_t size, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 		~SoASet();
 
 		[[nodiscard]] constexpr std::vector<SubSet>& GetSets();
 
-		void Swap(uint32_t aDenseId, uint32_t bDenseId) override;
+		void Swap(uint32_t aDenseId, uint32_t bDenseId);
 
 		template <typename U>
 		SubSet AddSubSet();
@@ -35,55 +36,61 @@ namespace ce
 		std::vector<SubSet> _subSets{};
 	};
 
-	template <typename T>
+	template <typename T, typename Derived>
 	template <typename U>
-	constexpr U* SoASet<T>::SubSet::Get()
+	constexpr U* SoASet<T, Derived>::SubSet::Get()
 	{
 		return reinterpret_cast<U*>(_data);
 	}
 
-	template <typename T>
+	template <typename T, typename Derived>
 	template <typename U>
-	constexpr U& SoASet<T>::SubSet::Get(const uint32_t sparseId)
+	constexpr U& SoASet<T, Derived>::SubSet::Get(const uint32_t sparseId)
 	{
 		return *reinterpret_cast<U*>(&_data[_unitSize * sparseId]);
 	}
 
-	template <typename T>
+	template <typename T, typename Derived>
 	template <typename U>
-	typename SoASet<T>::SubSet SoASet<T>::AddSubSet()
+	typename SoASet<T, Derived>::SubSet SoASet<T, Derived>::AddSubSet()
 	{
 		SubSet set{};
-		set._data = reinterpret_cast<char*>(malloc(sizeof(U) * (SparseSet<T>::GetSize() + 1)));
+		auto& resource = SoASet<T, Derived>::GetMemoryResource();
+		set._data = static_cast<char*>(resource.allocate(sizeof(U) * (SoASet<T, Derived>::GetSize() + 1), alignof(U)));
 		set._unitSize = sizeof(U);
+		set._alignment = alignof(U);
 		_subSets.push_back(set);
 		return set;
 	}
 
-	template <typename T>
-	SoASet<T>::SoASet(const uint32_t size) : SparseSet<T>(size)
+	template <typename T, typename Derived>
+	SoASet<T, Derived>::SoASet(const uint32_t size, std::pmr::memory_resource* resource) :
+		SparseSet<T, CrtpType<SoASet<T, Derived>, Derived>>(size, resource)
 	{
 
 	}
 
-	template <typename T>
-	SoASet<T>::~SoASet()
+	template <typename T, typename Derived>
+	SoASet<T, Derived>::~SoASet()
 	{
+		auto& resource = SoASet<T, Derived>::GetMemoryResource();
+		const uint32_t size = SoASet<T, Derived>::GetSize();
+
 		for (const auto& subSet : _subSets)
-			free(subSet._data);
+			resource.deallocate(subSet._data, subSet._unitSize * (size + 1), subSet._alignment);
 	}
 
-	template <typename T>
-	constexpr std::vector<typename SoASet<T>::SubSet>& SoASet<T>::GetSets()
+	template <typename T, typename Derived>
+	constexpr std::vector<typename SoASet<T, Derived>::SubSet>& SoASet<T, Derived>::GetSets()
 	{
 		return _subSets;
 	}
 
-	template <typename T>
-	void SoASet<T>::Swap(const uint32_t aDenseId, const uint32_t bDenseId)
+	template <typename T, typename Derived>
+	void SoASet<T, Derived>::Swap(const uint32_t aDenseId, const uint32_t bDenseId)
 	{
-		const uint32_t size = SparseSet<T>::GetSize();
-		SparseSet<T>::Swap(aDenseId, bDenseId);
+		const uint32_t size = SoASet<T, Derived>::GetSize();
+		SparseSet<T, CrtpType<SoASet<T, Derived>, Derived>>::Swap(aDenseId, bDenseId);
 
 		for (const auto& subSet : _subSets)
 		{
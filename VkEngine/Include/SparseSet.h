@@ -1,11 +1,21 @@
 #pragma once
+#include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <memory>
 #include <utility>
+#include <type_traits>
 #include "Set.h"
+#include "TrackedResource.h"
 
 namespace ce
 {
-	template <typename T>
+	// Resolves the type compile time hooks are dispatched to, which is the set itself when nothing derives from it.
+	template <typename Base, typename Derived>
+	using CrtpType = std::conditional_t<std::is_void_v<Derived>, Base, Derived>;
+
+	template <typename T, typename Derived = void>
 	class SparseSet : public Set
 	{
 	public:
@@ -18,7 +28,7 @@ namespace ce
 		class Iterator final
 		{
 		public:
-			explicit Iterator(SparseSet<T>& set, uint32_t index);
+			explicit Iterator(SparseSet<T, Derived>& set, uint32_t index);
 
 			Value operator*() const;
 			Value operator->() const;
@@ -38,102 +48,119 @@ namespace ce
 
 		private:
 			uint32_t _index = 0;
-			SparseSet<T>& _set;
+			SparseSet<T, Derived>& _set;
 		};
 
 		SparseSet();
-		explicit SparseSet(uint32_t size);
-		SparseSet<T>& operator=(const SparseSet<T>& other) = delete;
+		explicit SparseSet(uint32_t size, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		SparseSet<T, Derived>& operator=(const SparseSet<T, Derived>& other) = delete;
 		~SparseSet();
 
 		[[nodiscard]] constexpr T& operator[](uint32_t sparseId);
 
-		virtual T& Insert(uint32_t sparseId);
+		T& Insert(uint32_t sparseId);
+		// Appends count values at once. None of the sparse ids can be in the set already.
+		void InsertRange(const uint32_t* sparseIds, uint32_t count, const T& value);
 		void Erase(uint32_t sparseId) override;
 
 		[[nodiscard]] constexpr bool Contains(uint32_t sparseId) const;
 		[[nodiscard]] constexpr uint32_t GetCount() const;
 		[[nodiscard]] constexpr uint32_t GetSize() const;
 
-		virtual void Swap(uint32_t aDenseId, uint32_t bDenseId);
+		void Swap(uint32_t aDenseId, uint32_t bDenseId);
 
 		[[nodiscard]] constexpr uint32_t GetDenseId(uint32_t sparseId) const;
 		[[nodiscard]] constexpr uint32_t GetSparseId(uint32_t denseId) const;
+		// Values in dense order.
+		[[nodiscard]] constexpr T* GetValues();
 
 		[[nodiscard]] constexpr Iterator begin();
 		[[nodiscard]] constexpr Iterator end();
 
+		// Memory allocated by this set, including the memory of derived sets.
+		[[nodiscard]] constexpr const TrackedResource::Stats& GetMemoryStats() const;
+
+	protected:
+		[[nodiscard]] constexpr CrtpType<SparseSet<T, Derived>, Derived>& GetDerived();
+		[[nodiscard]] constexpr TrackedResource& GetMemoryResource();
+
 	private:
-		T* _values;
-		uint32_t* _dense;
-		int32_t* _sparse;
+		TrackedResource _resource;
+		T* _values = nullptr;
+		uint32_t* _dense = nullptr;
+		int32_t* _sparse = nullptr;
 
 		uint32_t _count = 0;
-		uint32_t _size;
+		uint32_t _size = 0;
 	};
 
-	template <typename T>
-	SparseSet<T>::Iterator::Iterator(SparseSet<T>& set, const uint32_t index) : _index(index), _set(set)
+	template <typename T, typename Derived>
+	SparseSet<T, Derived>::Iterator::Iterator(SparseSet<T, Derived>& set, const uint32_t index) : _index(index), _set(set)
 	{
 	}
 
-	template <typename T>
-	typename SparseSet<T>::Value SparseSet<T>::Iterator::operator*() const
+	template <typename T, typename Derived>
+	typename SparseSet<T, Derived>::Value SparseSet<T, Derived>::Iterator::operator*() const
 	{
 		return { _set._values[_index], _set._dense[_index] };
 	}
 
-	template <typename T>
-	typename SparseSet<T>::Value SparseSet<T>::Iterator::operator->() const
+	template <typename T, typename Derived>
+	typename SparseSet<T, Derived>::Value SparseSet<T, Derived>::Iterator::operator->() const
 	{
 		return { _set._values[_index], _set._dense[_index] };
 	}
 
-	template <typename T>
-	const typename SparseSet<T>::Iterator& SparseSet<T>::Iterator::operator++()
+	template <typename T, typename Derived>
+	const typename SparseSet<T, Derived>::Iterator& SparseSet<T, Derived>::Iterator::operator++()
 	{
 		++_index;
 		return *this;
 	}
 
-	template <typename T>
-	typename SparseSet<T>::Iterator SparseSet<T>::Iterator::operator++(int)
+	template <typename T, typename Derived>
+	typename SparseSet<T, Derived>::Iterator SparseSet<T, Derived>::Iterator::operator++(int)
 	{
 		Iterator temp{ *this };
 		++_index;
 		return temp;
 	}
 
-	template <typename T>
-	SparseSet<T>::SparseSet() = default;
+	template <typename T, typename Derived>
+	SparseSet<T, Derived>::SparseSet() = default;
 
-	template <typename T>
-	SparseSet<T>::SparseSet(const uint32_t size) : _size(size)
+	template <typename T, typename Derived>
+	SparseSet<T, Derived>::SparseSet(const uint32_t size, std::pmr::memory_resource* resource) : _resource(resource), _size(size)
 	{
-		_values = new T[size];
-		_dense = new uint32_t[size];
-		_sparse = new int32_t[size];
+		_values = static_cast<T*>(_resource.allocate(sizeof(T) * size, alignof(T)));
+		_dense = static_cast<uint32_t*>(_resource.allocate(sizeof(uint32_t) * size, alignof(uint32_t)));
+		_sparse = static_cast<int32_t*>(_resource.allocate(sizeof(int32_t) * size, alignof(int32_t)));
+		std::uninitialized_default_construct_n(_values, size);
 
 		for (uint32_t i = 0; i < size; ++i)
 			_sparse[i] = -1;
 	}
 
-	template <typename T>
-	SparseSet<T>::~SparseSet()
+	template <typename T, typename Derived>
+	SparseSet<T, Derived>::~SparseSet()
 	{
-		delete[] _values;
-		delete[] _dense;
-		delete[] _sparse;
+		if (!_values)
+			return;
+
+		std::destroy_n(_values, _size);
+		_resource.deallocate(_values, sizeof(T) * _size, alignof(T));
+		_resource.deallocate(_dense, sizeof(uint32_t) * _size, alignof(uint32_t));
+		_resource.deallocate(_sparse, sizeof(int32_t) * _size, alignof(int32_t));
 	}
 
-	template <typename T>
-	constexpr T& SparseSet<T>::operator[](const uint32_t sparseId)
+	template <typename T, typename Derived>
+	constexpr T& SparseSet<T, Derived>::operator[](const uint32_t sparseId)
 	{
 		return _values[_sparse[sparseId]];
 	}
 
-	template <typename T>
-	T& SparseSet<T>::Insert(const uint32_t sparseId)
+	template <typename T, typename Derived>
+	T& SparseSet<T, Derived>::Insert(const uint32_t sparseId)
 	{
 		if(!Contains(sparseId))
 		{
@@ -145,37 +172,52 @@ namespace ce
 		return _values[_sparse[sparseId]];
 	}
 
-	template <typename T>
-	void SparseSet<T>::Erase(const uint32_t sparseId)
+	template <typename T, typename Derived>
+	void SparseSet<T, Derived>::InsertRange(const uint32_t* sparseIds, const uint32_t count, const T& value)
+	{
+		// A second dense row for the same id would corrupt the set, unlike Insert which returns the existing value.
+		for (uint32_t i = 0; i < count; ++i)
+			assert(!Contains(sparseIds[i]));
+
+		std::fill(&_values[_count], &_values[_count + count], value);
+		memcpy(&_dense[_count], sparseIds, sizeof(uint32_t) * count);
+
+		for (uint32_t i = 0; i < count; ++i)
+			_sparse[sparseIds[i]] = _count + i;
+		_count += count;
+	}
+
+	template <typename T, typename Derived>
+	void SparseSet<T, Derived>::Erase(const uint32_t sparseId)
 	{
 		const int32_t denseId = _sparse[sparseId];
-		Swap(denseId, --_count);
+		GetDerived().Swap(denseId, --_count);
 
 		_sparse[sparseId] = -1;
 		_values[_count] = T();
 	}
 
-	template <typename T>
-	constexpr bool SparseSet<T>::Contains(const uint32_t sparseId) const
+	template <typename T, typename Derived>
+	constexpr bool SparseSet<T, Derived>::Contains(const uint32_t sparseId) const
 	{
 		const int32_t i = _sparse[sparseId];
 		return i != -1;
 	}
 
-	template <typename T>
-	constexpr uint32_t SparseSet<T>::GetCount() const
+	template <typename T, typename Derived>
+	constexpr uint32_t SparseSet<T, Derived>::GetCount() const
 	{
 		return _count;
 	}
 
-	template <typename T>
-	constexpr uint32_t SparseSet<T>::GetSize() const
+	template <typename T, typename Derived>
+	constexpr uint32_t SparseSet<T, Derived>::GetSize() const
 	{
 		return _size;
 	}
 
-	template <typename T>
-	void SparseSet<T>::Swap(const uint32_t aDenseId, const uint32_t bDenseId)
+	template <typename T, typename Derived>
+	void SparseSet<T, Derived>::Swap(const uint32_t aDenseId, const uint32_t bDenseId)
 	{
 		const int32_t aSparse = _dense[aDenseId];
 		const int32_t bSparse = _dense[aDenseId] = _dense[bDenseId];
@@ -189,26 +231,50 @@ namespace ce
 		_sparse[bSparse] = aDenseId;
 	}
 
-	template <typename T>
-	constexpr uint32_t SparseSet<T>::GetDenseId(const uint32_t sparseId) const
+	template <typename T, typename Derived>
+	constexpr uint32_t SparseSet<T, Derived>::GetDenseId(const uint32_t sparseId) const
 	{
 		return _sparse[sparseId];
 	}
 
-	template <typename T>
-	constexpr uint32_t SparseSet<T>::GetSparseId(const uint32_t denseId) const
+	template <typename T, typename Derived>
+	constexpr uint32_t SparseSet<T, Derived>::GetSparseId(const uint32_t denseId) const
 	{
 		return _dense[denseId];
 	}
 
-	template <typename T>
-	constexpr typename SparseSet<T>::Iterator SparseSet<T>::begin()
+	template <typename T, typename Derived>
+	constexpr T* SparseSet<T, Derived>::GetValues()
+	{
+		return _values;
+	}
+
+	template <typename T, typename Derived>
+	constexpr CrtpType<SparseSet<T, Derived>, Derived>& SparseSet<T, Derived>::GetDerived()
+	{
+		return static_cast<CrtpType<SparseSet<T, Derived>, Derived>&>(*this);
+	}
+
+	template <typename T, typename Derived>
+	constexpr TrackedResource& SparseSet<T, Derived>::GetMemoryResource()
+	{
+		return _resource;
+	}
+
+	template <typename T, typename Derived>
+	constexpr const TrackedResource::Stats& SparseSet<T, Derived>::GetMemoryStats() const
+	{
+		return _resource.GetStats();
+	}
+
+	template <typename T, typename Derived>
+	constexpr typename SparseSet<T, Derived>::Iterator SparseSet<T, Derived>::begin()
 	{
 		return Iterator{ *this, 0 };
 	}
 
-	template <typename T>
-	constexpr typename SparseSet<T>::Iterator SparseSet<T>::end()
+	template <typename T, typename Derived>
+	constexpr typename SparseSet<T, Derived>::Iterator SparseSet<T, Derived>::end()
 	{
 		return Iterator{ *this, _count };
 	}
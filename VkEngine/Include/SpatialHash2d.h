@@ -0,0 +1,97 @@
+﻿#pragma once
+#include <thread>
+#include "WorkerPool.h"
+
+// Broadphase over every Transform2d, which is rebuilt from the dense array every update.
+// Entries are radix sorted on the hash of their cell into one flat array, instead of being stored in buckets that allocate.
+// The update and pair search are split over a pool of threads that lives as long as the hash.
+class SpatialHash2d final
+{
+public:
+	typedef Singleton<SpatialHash2d> Instance;
+
+	struct Settings final
+	{
+		float cellSize = 1;
+		// Has to be a power of two, or zero to scale it with the size.
+		uint32_t cellCount = 0;
+		uint32_t threadCount = std::thread::hardware_concurrency();
+	};
+
+	explicit SpatialHash2d(uint32_t size);
+	SpatialHash2d(uint32_t size, const Settings& settings);
+
+	void Update();
+
+	void QueryAabb(const glm::vec2& min, const glm::vec2& max, std::vector<uint32_t>& outSparseIds) const;
+	void QueryRadius(const glm::vec2& center, float radius, std::vector<uint32_t>& outSparseIds) const;
+	// Finds every pair of transforms with overlapping bounds, where every pair is only added once.
+	void FindPairs(std::vector<std::pair<uint32_t, uint32_t>>& outPairs);
+
+private:
+	static constexpr uint32_t radixBits = 11;
+	static constexpr uint32_t radixSize = 1 << radixBits;
+
+	// Entries carry a copy of the bounds, so that queries do not have to look them up.
+	struct Entry final
+	{
+		glm::vec4 bounds;
+		glm::ivec2 cell;
+		uint32_t hash;
+		uint32_t sparseId;
+	};
+
+	Settings _settings;
+	uint32_t _cellCount;
+	uint32_t _threadCount;
+	WorkerPool _workers;
+
+	// Bounds of every transform in dense order, stored as min x, min y, max x, max y.
+	std::vector<glm::vec4> _bounds{};
+	std::vector<uint32_t> _threadOffsets{};
+	std::vector<uint32_t> _histograms{};
+	std::vector<uint32_t> _cellStarts{};
+	std::vector<Entry> _entries{};
+	std::vector<Entry> _sortBuffer{};
+	std::vector<std::vector<std::pair<uint32_t, uint32_t>>> _threadPairs{};
+
+	[[nodiscard]] glm::ivec2 GetCell(const glm::vec2& position) const;
+	[[nodiscard]] uint32_t GetHash(const glm::ivec2& cell) const;
+
+	void SortPass(uint32_t shift);
+
+	template <typename Test>
+	void Query(const glm::vec2& min, const glm::vec2& max, Test test, std::vector<uint32_t>& outSparseIds) const;
+};
+
+template <typename Test>
+void SpatialHash2d::Query(const glm::vec2& min, const glm::vec2& max, Test test, std::vector<uint32_t>& outSparseIds) const
+{
+	const glm::ivec2 minCell = GetCell(min);
+	const glm::ivec2 maxCell = GetCell(max);
+
+	for (int32_t x = minCell.x; x <= maxCell.x; ++x)
+		for (int32_t y = minCell.y; y <= maxCell.y; ++y)
+		{
+			const glm::ivec2 cell{ x, y };
+			const uint32_t hash = GetHash(cell);
+
+			for (uint32_t i = _cellStarts[hash]; i < _cellStarts[hash + 1]; ++i)
+			{
+				const auto& entry = _entries[i];
+				if (entry.cell != cell)
+					continue;
+
+				const auto& bounds = entry.bounds;
+				if (bounds.z < min.x || bounds.w < min.y || max.x < bounds.x || max.y < bounds.y)
+					continue;
+
+				// Transforms can be in multiple cells, so only the cell that contains the corner of the overlap adds it.
+				if (GetCell(glm::max(min, glm::vec2(bounds))) != cell)
+					continue;
+
+				if (test(bounds))
+					outSparseIds.push_back(entry.sparseId);
+			}
+		}
+}
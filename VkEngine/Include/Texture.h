@@ -1,10 +1,15 @@
 #pragma once
+#include "VkRenderer/MemoryAllocator.h"
 
 struct Texture final
 {
 	glm::ivec2 resolution;
 	uint32_t channels;
 	VkImage image;
-	VkDeviceMemory imageMemory;
+	vi::Allocation imageMemory;
 	VkImageView imageView;
+	// Slot in the bindless texture array, if enabled.
+	uint32_t index = UINT32_MAX;
+	// Ticket of the upload, see RenderSystem::IsReady.
+	uint64_t upload = 0;
 };
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <memory_resource>
+
+namespace ce
+{
+	// Forwards allocations to an upstream resource and keeps track of how much memory is in use.
+	class TrackedResource final : public std::pmr::memory_resource
+	{
+	public:
+		struct Stats final
+		{
+			size_t bytes = 0;
+			size_t peakBytes = 0;
+			uint32_t allocationCount = 0;
+		};
+
+		explicit TrackedResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+		[[nodiscard]] constexpr const Stats& GetStats() const;
+		[[nodiscard]] constexpr std::pmr::memory_resource* GetUpstream() const;
+
+	private:
+		std::pmr::memory_resource* _upstream;
+		Stats _stats{};
+
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+		[[nodiscard]] bool do_is_equal(const memory_resource& other) const noexcept override;
+	};
+
+	inline TrackedResource::TrackedResource(std::pmr::memory_resource* upstream) : _upstream(upstream)
+	{
+	}
+
+	constexpr const TrackedResource::Stats& TrackedResource::GetStats() const
+	{
+		return _stats;
+	}
+
+	constexpr std::pmr::memory_resource* TrackedResource::GetUpstream() const
+	{
+		return _upstream;
+	}
+
+	inline void* TrackedResource::do_allocate(const size_t bytes, const size_t alignment)
+	{
+		void* p = _upstream->allocate(bytes, alignment);
+
+		_stats.bytes += bytes;
+		_stats.peakBytes = _stats.bytes > _stats.peakBytes ? _stats.bytes : _stats.peakBytes;
+		_stats.allocationCount++;
+		return p;
+	}
+
+	inline void TrackedResource::do_deallocate(void* p, const size_t bytes, const size_t alignment)
+	{
+		_upstream->deallocate(p, bytes, alignment);
+
+		_stats.bytes -= bytes;
+		_stats.allocationCount--;
+	}
+
+	inline bool TrackedResource::do_is_equal(const memory_resource& other) const noexcept
+	{
+		return this == &other;
+	}
+}
@@ -1,16 +1,69 @@
 #pragma once
+#include "TransformSet.h"
 
 struct Transform2d final
 {
 	glm::vec2 position{};
 	glm::vec2 scale{ 1 };
 	float rotation = 0;
+	bool manualBake = false;
 
-	class System final : public ce::SparseSet<Transform2d>
+	struct Baked final
+	{
+		// Affine transform with the translation in the last column.
+		glm::mat3x2 model{ 1 };
+	};
+
+	class System final : public TransformSet<Transform2d, Baked, System>
 	{
 	public:
 		typedef Singleton<System> Instance;
 
 		explicit System(uint32_t size);
+
+		void Bake(Transform2d& transform, Baked& bake) const;
+
+	private:
+		friend TransformSet<Transform2d, Baked, System>;
+
+		template <typename V, bool Interpolated>
+		static void BakeBatch(const Transform2d* transforms, const Transform2d* previous, V alpha, Baked* bakes);
+		[[nodiscard]] static Transform2d Interpolate(const Transform2d& previous, const Transform2d& current, float alpha);
 	};
 };
+
+template <typename V, bool Interpolated>
+void Transform2d::System::BakeBatch(const Transform2d* transforms, const Transform2d* previous, const V alpha, Baked* bakes)
+{
+	constexpr uint32_t width = V::width;
+
+	V sin, cos;
+	simd::SinCos(Load<V, Interpolated>(&transforms->rotation, &previous->rotation, alpha), sin, cos);
+
+	const V sx = Load<V, Interpolated>(&transforms->scale.x, &previous->scale.x, alpha);
+	const V sy = Load<V, Interpolated>(&transforms->scale.y, &previous->scale.y, alpha);
+
+	float output[6][width];
+	(sx * cos).Store(output[0]);
+	(sy * sin).Store(output[1]);
+	(V::Splat(0) - sx * sin).Store(output[2]);
+	(sy * cos).Store(output[3]);
+
+	if constexpr (Interpolated)
+	{
+		Load<V, Interpolated>(&transforms->position.x, &previous->position.x, alpha).Store(output[4]);
+		Load<V, Interpolated>(&transforms->position.y, &previous->position.y, alpha).Store(output[5]);
+	}
+
+	for (uint32_t i = 0; i < width; ++i)
+	{
+		glm::vec2 position = transforms[i].position;
+		if constexpr (Interpolated)
+			position = { output[4][i], output[5][i] };
+
+		bakes[i].model = glm::mat3x2(
+			glm::vec2(output[0][i], output[1][i]),
+			glm::vec2(output[2][i], output[3][i]),
+			position);
+	}
+}
\ No newline at end of file
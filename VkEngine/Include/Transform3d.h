@@ -1,25 +1,131 @@
 ﻿#pragma once
-#include "SoASet.h"
+#include "TransformSet.h"
 
 struct Transform3d final
 {
 	glm::vec3 position{};
-	glm::vec3 rotation{};
+	glm::quat rotation{ 1, 0, 0, 0 };
 	glm::vec3 scale{1};
 	bool manualBake = false;
 
+	// Converts Euler angles in degrees to the rotation, matching the rotation of the former Euler transforms.
+	void SetEulerRotation(const glm::vec3& degrees);
+
 	struct Baked final
 	{
 		glm::mat4 model{1};
 	};
 
-	class System final : public ce::SoASet<Transform3d>
+	class System final : public TransformSet<Transform3d, Baked, System>
 	{
 	public:
 		typedef Singleton<System> Instance;
 
+		// Periodically reorders the dense storage along a Morton curve, so that nearby transforms are nearby in memory.
+		struct SortSettings final
+		{
+			bool enabled = false;
+			// Frames between two sorts.
+			uint32_t interval = 60;
+			// Limits how much of a sort is applied each frame.
+			uint32_t swapsPerFrame = 256;
+			float cellSize = 1;
+		};
+
 		explicit System(uint32_t size);
-		void Update();
+		System(uint32_t size, const SortSettings& sortSettings);
+
+		// Applies the sort before baking.
+		void Update(float alpha = 1);
 		void Bake(Transform3d& transform, Baked& bake) const;
+
+	private:
+		friend TransformSet<Transform3d, Baked, System>;
+
+		SortSettings _sortSettings;
+		uint32_t _sortFrame = 0;
+		uint32_t _sortIndex = 0;
+		uint32_t _sortDenseId = 0;
+		std::vector<std::pair<uint64_t, uint32_t>> _sortKeys{};
+
+		template <typename V, bool Interpolated>
+		static void BakeBatch(const Transform3d* transforms, const Transform3d* previous, V alpha, Baked* bakes);
+		[[nodiscard]] static Transform3d Interpolate(const Transform3d& previous, const Transform3d& current, float alpha);
+
+		void Sort();
+		[[nodiscard]] uint64_t GetMortonKey(const glm::vec3& position) const;
 	};
 };
+
+template <typename V, bool Interpolated>
+void Transform3d::System::BakeBatch(const Transform3d* transforms, const Transform3d* previous, const V alpha, Baked* bakes)
+{
+	constexpr uint32_t width = V::width;
+
+	V qx = Gather<V>(&transforms->rotation.x);
+	V qy = Gather<V>(&transforms->rotation.y);
+	V qz = Gather<V>(&transforms->rotation.z);
+	V qw = Gather<V>(&transforms->rotation.w);
+
+	const V sx = Load<V, Interpolated>(&transforms->scale.x, &previous->scale.x, alpha);
+	const V sy = Load<V, Interpolated>(&transforms->scale.y, &previous->scale.y, alpha);
+	const V sz = Load<V, Interpolated>(&transforms->scale.z, &previous->scale.z, alpha);
+
+	const V one = V::Splat(1);
+	V two = V::Splat(2);
+
+	float positions[3][width];
+	if constexpr (Interpolated)
+	{
+		V px = Gather<V>(&previous->rotation.x);
+		V py = Gather<V>(&previous->rotation.y);
+		V pz = Gather<V>(&previous->rotation.z);
+		V pw = Gather<V>(&previous->rotation.w);
+
+		// Blend along the shortest arc, the blended rotation is normalized as part of the conversion.
+		const V dot = px * qx + py * qy + pz * qz + pw * qw;
+		px = simd::MulSign(px, dot);
+		py = simd::MulSign(py, dot);
+		pz = simd::MulSign(pz, dot);
+		pw = simd::MulSign(pw, dot);
+
+		qx = px + (qx - px) * alpha;
+		qy = py + (qy - py) * alpha;
+		qz = pz + (qz - pz) * alpha;
+		qw = pw + (qw - pw) * alpha;
+		two = two / (qx * qx + qy * qy + qz * qz + qw * qw);
+
+		Load<V, Interpolated>(&transforms->position.x, &previous->position.x, alpha).Store(positions[0]);
+		Load<V, Interpolated>(&transforms->position.y, &previous->position.y, alpha).Store(positions[1]);
+		Load<V, Interpolated>(&transforms->position.z, &previous->position.z, alpha).Store(positions[2]);
+	}
+
+	const V xx = qx * qx, yy = qy * qy, zz = qz * qz;
+	const V xy = qx * qy, xz = qx * qz, yz = qy * qz;
+	const V wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+	float output[9][width];
+	((one - two * (yy + zz)) * sx).Store(output[0]);
+	(two * (xy + wz) * sx).Store(output[1]);
+	(two * (xz - wy) * sx).Store(output[2]);
+	(two * (xy - wz) * sy).Store(output[3]);
+	((one - two * (xx + zz)) * sy).Store(output[4]);
+	(two * (yz + wx) * sy).Store(output[5]);
+	(two * (xz + wy) * sz).Store(output[6]);
+	(two * (yz - wx) * sz).Store(output[7]);
+	((one - two * (xx + yy)) * sz).Store(output[8]);
+
+	for (uint32_t i = 0; i < width; ++i)
+	{
+		glm::vec3 position = transforms[i].position;
+		if constexpr (Interpolated)
+			position = { positions[0][i], positions[1][i], positions[2][i] };
+
+		auto& model = bakes[i].model;
+		model = glm::mat4(
+			glm::vec4(output[0][i], output[1][i], output[2][i], 0),
+			glm::vec4(output[3][i], output[4][i], output[5][i], 0),
+			glm::vec4(output[6][i], output[7][i], output[8][i], 0),
+			glm::vec4(position, 1));
+	}
+}
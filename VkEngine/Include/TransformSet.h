@@ -0,0 +1,152 @@
+﻿#pragma once
+#include "SoASet.h"
+#include "Simd.h"
+
+// Shared storage and baking of the transform systems, which keep the state of the previous tick to interpolate from.
+// Derived only provides the math for its dimensions: Bake, Interpolate, and BakeBatch for a vector width of transforms at once.
+template <typename Transform, typename Baked, typename Derived>
+class TransformSet : public ce::SoASet<Transform, Derived>
+{
+public:
+	explicit TransformSet(uint32_t size);
+
+	Transform& Insert(uint32_t sparseId);
+	void InsertRange(const uint32_t* sparseIds, uint32_t count, const Transform& value);
+
+	// Keeps the current state to interpolate from, which has to be called at the start of every fixed tick.
+	void StorePrevious();
+	// Bakes the state between the previous and the current tick, where an alpha of 1 bakes the current state.
+	void Update(float alpha = 1);
+
+protected:
+	// Loads a member of every transform in a batch. The transforms are stored as an array of structs,
+	// so the members are gathered with strided loads, which bounds the speedup of batching by memory bandwidth.
+	template <typename V>
+	[[nodiscard]] static V Gather(const float* member);
+	// Gathers a member, blended with the previous state when interpolating.
+	template <typename V, bool Interpolated>
+	[[nodiscard]] static V Load(const float* member, const float* previousMember, V alpha);
+
+private:
+	// Transforms that have been added after the previous state was stored.
+	std::vector<uint32_t> _insertedIds{};
+
+	template <bool Interpolated>
+	void BakeAll(float alpha);
+};
+
+template <typename Transform, typename Baked, typename Derived>
+TransformSet<Transform, Baked, Derived>::TransformSet(const uint32_t size) : ce::SoASet<Transform, Derived>(size)
+{
+	ce::SoASet<Transform, Derived>::template AddSubSet<Baked>();
+	// The state of the previous tick.
+	ce::SoASet<Transform, Derived>::template AddSubSet<Transform>();
+}
+
+template <typename Transform, typename Baked, typename Derived>
+Transform& TransformSet<Transform, Baked, Derived>::Insert(const uint32_t sparseId)
+{
+	_insertedIds.push_back(sparseId);
+	return ce::SoASet<Transform, Derived>::Insert(sparseId);
+}
+
+template <typename Transform, typename Baked, typename Derived>
+void TransformSet<Transform, Baked, Derived>::InsertRange(const uint32_t* sparseIds, const uint32_t count, const Transform& value)
+{
+	_insertedIds.insert(_insertedIds.end(), sparseIds, sparseIds + count);
+	ce::SoASet<Transform, Derived>::InsertRange(sparseIds, count, value);
+}
+
+template <typename Transform, typename Baked, typename Derived>
+void TransformSet<Transform, Baked, Derived>::StorePrevious()
+{
+	auto& sets = ce::SoASet<Transform, Derived>::GetSets();
+	memcpy(sets[1].template Get<Transform>(), ce::SoASet<Transform, Derived>::GetValues(),
+		sizeof(Transform) * ce::SoASet<Transform, Derived>::GetCount());
+	_insertedIds.clear();
+}
+
+template <typename Transform, typename Baked, typename Derived>
+void TransformSet<Transform, Baked, Derived>::Update(const float alpha)
+{
+	auto& sets = ce::SoASet<Transform, Derived>::GetSets();
+	const auto previous = sets[1].template Get<Transform>();
+	const auto transforms = ce::SoASet<Transform, Derived>::GetValues();
+
+	// New transforms have nothing to interpolate from yet.
+	for (const uint32_t sparseId : _insertedIds)
+		if (ce::SoASet<Transform, Derived>::Contains(sparseId))
+		{
+			const uint32_t denseId = ce::SoASet<Transform, Derived>::GetDenseId(sparseId);
+			previous[denseId] = transforms[denseId];
+		}
+	_insertedIds.clear();
+
+	if (alpha < 1)
+		BakeAll<true>(alpha);
+	else
+		BakeAll<false>(alpha);
+}
+
+template <typename Transform, typename Baked, typename Derived>
+template <typename V>
+V TransformSet<Transform, Baked, Derived>::Gather(const float* member)
+{
+	static_assert(sizeof(Transform) % sizeof(float) == 0);
+	return V::Gather(member, sizeof(Transform) / sizeof(float));
+}
+
+template <typename Transform, typename Baked, typename Derived>
+template <typename V, bool Interpolated>
+V TransformSet<Transform, Baked, Derived>::Load(const float* member, const float* previousMember, const V alpha)
+{
+	const V value = Gather<V>(member);
+	if constexpr (Interpolated)
+	{
+		const V from = Gather<V>(previousMember);
+		return from + (value - from) * alpha;
+	}
+	else
+		return value;
+}
+
+template <typename Transform, typename Baked, typename Derived>
+template <bool Interpolated>
+void TransformSet<Transform, Baked, Derived>::BakeAll(const float alpha)
+{
+	auto& sets = ce::SoASet<Transform, Derived>::GetSets();
+	auto& derived = ce::SoASet<Transform, Derived>::GetDerived();
+	const auto bakes = sets[0].template Get<Baked>();
+	const auto previous = sets[1].template Get<Transform>();
+	const auto transforms = ce::SoASet<Transform, Derived>::GetValues();
+	const uint32_t count = ce::SoASet<Transform, Derived>::GetCount();
+
+	// Bake in batches as wide as the target supports, the remainder is baked one by one.
+	constexpr uint32_t width = simd::Float::width;
+	uint32_t denseId = 0;
+	for (; denseId + width <= count; denseId += width)
+	{
+		Baked batch[width];
+		Derived::template BakeBatch<simd::Float, Interpolated>(&transforms[denseId], &previous[denseId], simd::Float::Splat(alpha), batch);
+
+		// Scatter the results, skipping the transforms that are baked manually.
+		for (uint32_t i = 0; i < width; ++i)
+			if (!transforms[denseId + i].manualBake)
+				bakes[denseId + i] = batch[i];
+	}
+
+	for (; denseId < count; ++denseId)
+	{
+		auto& instance = transforms[denseId];
+		if (instance.manualBake)
+			continue;
+
+		if constexpr (Interpolated)
+		{
+			auto interpolated = Derived::Interpolate(previous[denseId], instance, alpha);
+			derived.Bake(interpolated, bakes[denseId]);
+		}
+		else
+			derived.Bake(instance, bakes[denseId]);
+	}
+}
\ No newline at end of file
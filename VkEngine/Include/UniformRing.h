@@ -0,0 +1,56 @@
+﻿#pragma once
+#include "VkRenderer/VkRenderer.h"
+
+// Hands out uniform data for the frame that is being recorded, from a single buffer that stays mapped.
+// The data of a frame is reclaimed once the frame that used the same frame slot is no longer in flight.
+// Allocations are bound with dynamic offsets, and can only be made on the render thread.
+class UniformRing final
+{
+public:
+	struct Settings final
+	{
+		VkDeviceSize size = 1 << 20;
+	};
+
+	struct Allocation final
+	{
+		uint32_t offset;
+		void* data;
+	};
+
+	void Construct(vi::VkRenderer& renderer, uint32_t frameCount);
+	void Construct(vi::VkRenderer& renderer, uint32_t frameCount, const Settings& settings);
+	void Cleanup();
+
+	// Reclaims the data of the oldest frame, which has to happen after the GPU is done with that frame.
+	void BeginFrame();
+	void EndFrame();
+
+	[[nodiscard]] Allocation Allocate(VkDeviceSize size);
+	template <typename T>
+	[[nodiscard]] uint32_t Write(const T& value);
+
+	[[nodiscard]] VkBuffer GetBuffer() const;
+
+private:
+	vi::VkRenderer* _renderer = nullptr;
+	VkBuffer _buffer;
+	vi::Allocation _memory;
+	char* _data;
+	VkDeviceSize _size;
+	VkDeviceSize _alignment;
+
+	// Positions keep increasing, and wrap around the buffer.
+	uint64_t _head = 0;
+	uint64_t _tail = 0;
+	uint64_t _frame = 0;
+	std::vector<uint64_t> _frameEnds{};
+};
+
+template <typename T>
+uint32_t UniformRing::Write(const T& value)
+{
+	const auto allocation = Allocate(sizeof(T));
+	memcpy(allocation.data, &value, sizeof(T));
+	return allocation.offset;
+}
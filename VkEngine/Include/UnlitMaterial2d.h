@@ -1,33 +1,41 @@
 ﻿#pragma once
-#include "ShaderSet.h"
-#include "DescriptorPool.h"
+#include "InstancedShaderSet.h"
+#include "Camera2d.h"
+#include "Transform2d.h"
 
 struct UnlitMaterial2d final
 {
+	// Instances share their descriptor sets through the material cache, so they don't need any frame resources.
 	struct Frame final
 	{
-		VkDescriptorSet descriptorSet;
-		VkSampler matDiffuseSampler;
 	};
 
-	class System final : public ShaderSet<UnlitMaterial2d, Frame>
+	class System final : public InstancedShaderSet<UnlitMaterial2d, Frame, Vertex2d, Camera2d::System, System>
 	{
 	public:
 		typedef Singleton<System> Instance;
 
 		explicit System(uint32_t size);
-		void Cleanup() override;
-		void Update() override;
 
 	private:
-		vi::Pipeline _pipeline;
-		VkShaderModule _vertModule;
-		VkShaderModule _fragModule;
-		DescriptorPool _descriptorPool;
+		friend InstancedShaderSet<UnlitMaterial2d, Frame, Vertex2d, Camera2d::System, System>;
 
-		void ConstructInstanceFrame(Frame& frame, UnlitMaterial2d& material, uint32_t denseId) override;
-		void CleanupInstanceFrame(Frame& frame, UnlitMaterial2d& material, uint32_t denseId) override;
+		struct VisibleSprite final
+		{
+			uint32_t batch;
+			uint32_t transformId;
+			uint32_t textureIndex;
+		};
+
+		std::vector<VisibleSprite> _visibleSprites{};
+		std::vector<uint32_t> _batchOffsets{};
+
+		// Sprites are batched in the order they are stored in.
+		void FillPacket(Packet& packet);
 	};
 
 	Texture* diffuseTexture = nullptr;
-};
+	VkFilter diffuseFilter = VK_FILTER_LINEAR;
+	// The shared material that matches the parameters above, which is managed by the system.
+	uint32_t material = MaterialCache::invalidHandle;
+};
\ No newline at end of file
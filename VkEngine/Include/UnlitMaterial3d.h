@@ -1,33 +1,49 @@
 ﻿#pragma once
-#include "ShaderSet.h"
-#include "DescriptorPool.h"
+#include "InstancedShaderSet.h"
+#include "Camera3d.h"
+#include "Transform3d.h"
 
 struct UnlitMaterial3d final
 {
+	// Instances share their descriptor sets through the material cache, so they don't need any frame resources.
 	struct Frame final
 	{
-		VkDescriptorSet descriptorSet;
-		VkSampler matDiffuseSampler;
 	};
 
-	class System final : public ShaderSet<UnlitMaterial3d, Frame>
+	class System final : public InstancedShaderSet<UnlitMaterial3d, Frame, Vertex3d, Camera3d::System, System>
 	{
 	public:
 		typedef Singleton<System> Instance;
 
 		explicit System(uint32_t size);
-		void Cleanup() override;
-		void Update() override;
 
 	private:
-		vi::Pipeline _pipeline;
-		VkShaderModule _vertModule;
-		VkShaderModule _fragModule;
-		DescriptorPool _descriptorPool;
+		friend InstancedShaderSet<UnlitMaterial3d, Frame, Vertex3d, Camera3d::System, System>;
 
-		void ConstructInstanceFrame(Frame& frame, UnlitMaterial3d& material, uint32_t denseId) override;
-		void CleanupInstanceFrame(Frame& frame, UnlitMaterial3d& material, uint32_t denseId) override;
+		std::vector<float> _cullSpheres{};
+		std::vector<uint32_t> _visibleIds{};
+
+		struct BatchKey final
+		{
+			VkBuffer vertexBuffer;
+			VkBuffer indexBuffer;
+			uint32_t material;
+			uint32_t denseId;
+
+			[[nodiscard]] bool SharesBatch(const BatchKey& other) const;
+			[[nodiscard]] bool operator<(const BatchKey& other) const;
+		};
+
+		std::vector<BatchKey> _batchKeys{};
+
+		// Instances are sorted into batches, so that the draws don't depend on the order they are stored in.
+		void FillPacket(Packet& packet);
+		// Fills the visible ids with the dense ids of the instances that are inside the frustum.
+		void Cull(const glm::mat4& viewProjection);
 	};
 
 	Texture* diffuseTexture = nullptr;
+	VkFilter diffuseFilter = VK_FILTER_LINEAR;
+	// The shared material that matches the parameters above, which is managed by the system.
+	uint32_t material = MaterialCache::invalidHandle;
 };
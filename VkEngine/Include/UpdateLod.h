@@ -0,0 +1,95 @@
+﻿#pragma once
+
+// Spreads the updates of a system over multiple frames, so that distant or unimportant entities are updated less often.
+// Bucket k is updated every 2^k frames. A bucket is cut into as many slices as its period,
+// and every frame updates one slice of every bucket, which keeps the load even across frames.
+// The slices are cut from the members a bucket had when its period started, so every entity is updated once per period.
+class UpdateLod final : public ce::Set
+{
+public:
+	struct Settings final
+	{
+		uint32_t bucketCount = 4;
+		// Entities within this distance are updated every frame, and every doubling of the distance halves the rate.
+		float distance = 10;
+	};
+
+	explicit UpdateLod(uint32_t size);
+	UpdateLod(uint32_t size, const Settings& settings);
+
+	void Insert(uint32_t sparseId, uint32_t bucket = 0);
+	void Erase(uint32_t sparseId) override;
+
+	// Moving an entity to another bucket is allowed from within Update.
+	void Assign(uint32_t sparseId, uint32_t bucket);
+	void AssignByDistance(uint32_t sparseId, float distance);
+	// A priority of 1 or more is updated every frame, and every halving of the priority halves the rate.
+	void AssignByPriority(uint32_t sparseId, float priority);
+
+	// Advances a frame and calls func(sparseId, frames) for every due entity,
+	// where frames is the number of frames passed since that entity was last updated.
+	template <typename Func>
+	void Update(Func func);
+
+	[[nodiscard]] bool Contains(uint32_t sparseId) const;
+	[[nodiscard]] uint32_t GetBucket(uint32_t sparseId) const;
+	[[nodiscard]] uint32_t GetBucketCount() const;
+	// The number of entities updated by the last update.
+	[[nodiscard]] uint32_t GetDueCount() const;
+
+private:
+	struct Location final
+	{
+		int32_t bucket = -1;
+		uint32_t index = 0;
+		uint64_t lastFrame = 0;
+	};
+
+	Settings _settings;
+	std::vector<Location> _locations;
+	std::vector<std::vector<uint32_t>> _buckets;
+	std::vector<std::vector<uint32_t>> _periodMembers;
+	uint32_t _dueCount = 0;
+	uint64_t _frame = 0;
+
+	void Remove(uint32_t sparseId);
+	void Append(uint32_t sparseId, uint32_t bucket);
+};
+
+template <typename Func>
+void UpdateLod::Update(Func func)
+{
+	_frame++;
+	_dueCount = 0;
+
+	for (uint32_t i = 0; i < _buckets.size(); ++i)
+	{
+		const uint64_t period = 1ull << i;
+		const uint64_t slice = _frame & (period - 1);
+		const uint64_t periodStart = _frame - slice;
+
+		// Reassigning reorders the buckets, so the slices are cut from a copy that doesn't change during the period.
+		auto& members = _periodMembers[i];
+		if (slice == 0)
+			members = _buckets[i];
+
+		const uint64_t count = members.size();
+		const auto begin = static_cast<uint32_t>(count * slice / period);
+		const auto end = static_cast<uint32_t>(count * (slice + 1) / period);
+
+		for (uint32_t j = begin; j < end; ++j)
+		{
+			const uint32_t sparseId = members[j];
+			auto& location = _locations[sparseId];
+
+			// Entities that have been erased, or that have already been updated this period through another bucket, are skipped.
+			if (location.bucket == -1 || location.lastFrame >= periodStart)
+				continue;
+
+			const auto frames = static_cast<uint32_t>(_frame - location.lastFrame);
+			location.lastFrame = _frame;
+			_dueCount++;
+			func(sparseId, frames);
+		}
+	}
+}
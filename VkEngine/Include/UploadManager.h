@@ -0,0 +1,95 @@
+﻿#pragma once
+#include "VkRenderer/VkRenderer.h"
+#include <mutex>
+#include <atomic>
+
+// Batches the uploads of meshes and textures, which are written into a single staging buffer that stays mapped.
+// Uploads can be queued from any thread, and are recorded into the frame that is being recorded instead of being waited on.
+// Every upload returns a ticket, which is ready once the frame that recorded it is no longer in flight.
+// With a dedicated transfer queue the copies are submitted to that queue instead, and handed over to the frame.
+class UploadManager final
+{
+public:
+	struct Settings final
+	{
+		// Uploads that don't fit in the remainder of the ring get a temporary staging buffer.
+		VkDeviceSize stagingSize = 32 << 20;
+	};
+
+	// The stages that wait on the semaphore of the transfer queue.
+	static constexpr VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+	void Construct(vi::VkRenderer& renderer, uint32_t frameCount);
+	void Construct(vi::VkRenderer& renderer, uint32_t frameCount, const Settings& settings);
+	void Cleanup();
+
+	// Reclaims the staging data of the oldest frame, which has to happen after the GPU is done with that frame.
+	// Submits the queued uploads to the transfer queue if there is one, so it has to happen before the frame is recorded.
+	void BeginFrame();
+	// Records the queued uploads into the current command buffer, outside of a render pass. Has to happen once every frame.
+	// With a transfer queue only the ownership of the resources is acquired, after the frame waits on the semaphore.
+	void Record();
+	// The semaphore that the frame has to wait on, which is null if nothing was submitted to the transfer queue.
+	[[nodiscard]] VkSemaphore GetSemaphore() const;
+
+	// The destination is filled with the data, and can be used for vertex or index data afterwards.
+	[[nodiscard]] uint64_t Upload(VkBuffer dstBuffer, const void* data, VkDeviceSize size);
+	// The destination is filled with the data, and transitioned to be sampled in the fragment shader afterwards.
+	[[nodiscard]] uint64_t Upload(VkImage dstImage, glm::ivec2 resolution, const void* data, VkDeviceSize size);
+
+	[[nodiscard]] bool IsReady(uint64_t ticket) const;
+
+private:
+	struct Request final
+	{
+		VkBuffer dstBuffer = VK_NULL_HANDLE;
+		VkImage dstImage = VK_NULL_HANDLE;
+		glm::ivec2 resolution;
+		VkDeviceSize size;
+		VkBuffer srcBuffer;
+		VkDeviceSize srcOffset;
+	};
+
+	struct StagingBuffer final
+	{
+		VkBuffer buffer;
+		vi::Allocation memory;
+	};
+
+	struct Frame final
+	{
+		uint64_t end = 0;
+		uint64_t ticket = 0;
+		std::vector<StagingBuffer> stagingBuffers{};
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+	};
+
+	vi::VkRenderer* _renderer = nullptr;
+	bool _transferQueue;
+	VkBuffer _buffer;
+	vi::Allocation _memory;
+	char* _data;
+	VkDeviceSize _size;
+	VkDeviceSize _alignment;
+
+	// Guards everything that is shared between the uploading threads and the render thread.
+	std::mutex _mutex{};
+	std::vector<Request> _requests{};
+	std::vector<Request> _recording{};
+	std::vector<StagingBuffer> _stagingBuffers{};
+	// Positions keep increasing, and wrap around the buffer.
+	uint64_t _head = 0;
+	uint64_t _tail = 0;
+	uint64_t _ticket = 0;
+
+	std::atomic<uint64_t> _completedTicket = 0;
+	uint64_t _frame = 0;
+	std::vector<Frame> _frames{};
+	VkSemaphore _semaphore = VK_NULL_HANDLE;
+
+	void RecordCopies() const;
+	[[nodiscard]] uint64_t Enqueue(Request& request, const void* data);
+	[[nodiscard]] bool TryAllocate(VkDeviceSize size, VkDeviceSize& outOffset);
+	void DestroyStagingBuffer(const StagingBuffer& stagingBuffer);
+};
\ No newline at end of file
@@ -2,9 +2,21 @@
 
 struct Vertex2d final
 {
+    // The per instance data of an instanced draw.
+    struct Instance final
+    {
+        glm::mat3x2 model;
+        // Only used by bindless textures.
+        uint32_t textureIndex;
+    };
+
     glm::vec2 position{};
     glm::vec2 textureCoordinates{};
 
     [[nodiscard]] static VkVertexInputBindingDescription GetBindingDescription();
     [[nodiscard]] static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
+
+    // The instance data, read from binding 1 with the affine model matrix at locations 2 to 4 and the texture index at 5.
+    [[nodiscard]] static VkVertexInputBindingDescription GetInstanceBindingDescription();
+    [[nodiscard]] static std::vector<VkVertexInputAttributeDescription> GetInstanceAttributeDescriptions();
 };
@@ -2,10 +2,22 @@
 
 struct Vertex3d final
 {
+	// The per instance data of an instanced draw.
+	struct Instance final
+	{
+		glm::mat4 model;
+		// Only used by bindless textures.
+		uint32_t textureIndex;
+	};
+
 	glm::vec3 position{};
 	glm::vec3 normal{0, 0, 1};
 	glm::vec2 textureCoordinates{};
 
 	[[nodiscard]] static VkVertexInputBindingDescription GetBindingDescription();
 	[[nodiscard]] static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
+
+	// The instance data, read from binding 1 with the model matrix at locations 3 to 6 and the texture index at 7.
+	[[nodiscard]] static VkVertexInputBindingDescription GetInstanceBindingDescription();
+	[[nodiscard]] static std::vector<VkVertexInputAttributeDescription> GetInstanceAttributeDescriptions();
 };
@@ -0,0 +1,36 @@
+﻿#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Threads that are created once and reused for every parallel loop, since starting threads every call costs more than the loops themselves.
+class WorkerPool final
+{
+public:
+	typedef std::function<void(uint32_t begin, uint32_t end, uint32_t thread)> Job;
+
+	// The calling thread counts as one of the threads.
+	explicit WorkerPool(uint32_t threadCount);
+	~WorkerPool();
+
+	// Splits the range in a chunk per thread, and returns when every chunk is done.
+	void ParallelFor(uint32_t count, const Job& job);
+
+	[[nodiscard]] uint32_t GetThreadCount() const;
+
+private:
+	std::vector<std::thread> _threads{};
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::condition_variable _doneCondition;
+
+	const Job* _job = nullptr;
+	uint32_t _count = 0;
+	uint32_t _chunkSize = 0;
+	uint32_t _remaining = 0;
+	uint64_t _generation = 0;
+	bool _quit = false;
+
+	void Run(uint32_t thread);
+};
\ No newline at end of file
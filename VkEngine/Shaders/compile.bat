@@ -1,6 +1,10 @@
 %~dp0/glslc.exe shader2d.vert -o vert2d.spv
 %~dp0/glslc.exe shader2d.frag -o frag2d.spv
+%~dp0/glslc.exe shader2d_bindless.frag -o frag2d_bindless.spv
 
 %~dp0/glslc.exe shader3d.vert -o vert3d.spv
 %~dp0/glslc.exe shader3d.frag -o frag3d.spv
+%~dp0/glslc.exe shader3d_bindless.frag -o frag3d_bindless.spv
+if exist "%VULKAN_SDK%\Bin\spirv-val.exe" for %%f in (vert2d frag2d frag2d_bindless vert3d frag3d frag3d_bindless) do "%VULKAN_SDK%\Bin\spirv-val.exe" --target-env vulkan1.0 %%f.spv
+
 pause
\ No newline at end of file
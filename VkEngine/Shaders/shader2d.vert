@@ -3,6 +3,8 @@
 
 layout(location = 0) in vec2 inPosition;
 layout(location = 1) in vec2 inTexCoords;
+layout(location = 2) in mat3x2 inModel;
+layout(location = 5) in uint inTextureIndex;
 
 layout (set = 0, binding = 0) uniform Camera
 {
@@ -10,30 +12,13 @@ layout (set = 0, binding = 0) uniform Camera
     float aspectRatio;
 } camera;
 
-layout (push_constant) uniform PushConstants
-{
-    vec2 transPos;
-    vec2 transScale;
-    float transRot;
-} pushConstants;
-
 layout(location = 0) out vec2 outFragTexCoord;
 layout(location = 1) out vec2 outFragPos;
-
-vec2 rotate(vec2 vec, float rot)
-{
-    float s = sin(rot);
-    float c = cos(rot);
-
-    return vec2(vec.x * c - vec.y * s, vec.x * s + vec.y * c);
-}
+layout(location = 2) flat out uint outTextureIndex;
 
 vec2 get_pos()
 {
-    vec2 posRotated = rotate(inPosition, pushConstants.transRot);
-    vec2 posScaled = posRotated * pushConstants.transScale;
-    vec2 translatedPos = pushConstants.transPos + posScaled;
-    return translatedPos;
+    return inModel * vec3(inPosition, 1);
 }
 
 vec2 make_camera_relative(vec2 pos)
@@ -51,4 +36,5 @@ void main()
     gl_Position = vec4(make_camera_relative(pos), 0, 1);
     outFragPos = pos;
     outFragTexCoord = inTexCoords;
+    outTextureIndex = inTextureIndex;
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoords;
+layout(location = 3) in mat4 inModel;
+layout(location = 7) in uint inTextureIndex;
 
 layout (set = 0, binding = 0) uniform Camera
 {
@@ -11,18 +13,15 @@ layout (set = 0, binding = 0) uniform Camera
     mat4 projection;
 } camera;
 
-layout (push_constant) uniform PushConstants
-{
-    mat4 model;
-} pushConstants;
-
 layout(location = 0) out vec3 outNormal;
 layout(location = 1) out vec2 outFragTexCoord;
+layout(location = 2) flat out uint outTextureIndex;
 
 void main() 
 {
-    gl_Position = camera.projection * camera.view * pushConstants.model * vec4(inPosition, 1);
+    gl_Position = camera.projection * camera.view * inModel * vec4(inPosition, 1);
 
     outNormal = inNormal;
     outFragTexCoord = inTexCoords;
+    outTextureIndex = inTextureIndex;
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 450
+#extension GL_KHR_vulkan_glsl : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) in vec2 inFragTexCoord;
+layout(location = 2) flat in uint inTextureIndex;
+
+layout (set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(location = 0) out vec4 outColor;
+
+void main() 
+{
+    outColor = texture(textures[nonuniformEXT(inTextureIndex)], inFragTexCoord);
+}
\ No newline at end of file
@@ -0,0 +1,430 @@
+﻿#include "pch.h"
+#include "AabbTree.h"
+#include "Simd.h"
+#include "Transform3d.h"
+#include "Mesh.h"
+#include <cfloat>
+
+bool AabbTree::Node::IsLeaf() const
+{
+	return children[0] == -1;
+}
+
+Aabb AabbTree::Node::GetAabb() const
+{
+	return { { min[0], min[1], min[2] }, { max[0], max[1], max[2] } };
+}
+
+void AabbTree::Node::SetAabb(const Aabb& aabb)
+{
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		min[i] = aabb.min[i];
+		max[i] = aabb.max[i];
+	}
+
+	min[3] = 0;
+	max[3] = 0;
+}
+
+AabbTree::AabbTree(const uint32_t size) : AabbTree(size, Settings())
+{
+}
+
+AabbTree::AabbTree(const uint32_t size, const Settings& settings) : _settings(settings)
+{
+	_leaves.resize(size, -1);
+	_bounds.resize(size);
+	_nextBounds.resize(size);
+	_updateStamps.resize(size);
+}
+
+void AabbTree::Update()
+{
+	auto& transforms = Transform3d::System::Instance::Get();
+	auto& meshes = Mesh::System::Instance::Get();
+	const auto bakes = transforms.GetSets()[0].Get<Transform3d::Baked>();
+
+	_updateCount++;
+	_changes.clear();
+	_removals.clear();
+
+	// Only the writer changes the nodes, so they can be read without locking.
+	for (const auto [transform, sparseId] : transforms)
+	{
+		if (!meshes.Contains(sparseId))
+			continue;
+
+		_updateStamps[sparseId] = _updateCount;
+
+		const auto& mesh = meshes[sparseId];
+		const Aabb local{ mesh.boundsMin, mesh.boundsMax };
+		const Aabb aabb = local.Transform(bakes[transforms.GetDenseId(sparseId)].model);
+
+		auto& bounds = _nextBounds[sparseId];
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			bounds.min[i] = aabb.min[i];
+			bounds.max[i] = aabb.max[i];
+		}
+		bounds.min[3] = 0;
+		bounds.max[3] = 0;
+
+		const int32_t leaf = _leaves[sparseId];
+		if (leaf != -1 && _nodes[leaf].GetAabb().Contains(aabb))
+			continue;
+
+		_changes.emplace_back(sparseId, aabb);
+	}
+
+	// Remove the entities that lost their transform or mesh.
+	const uint32_t size = _leaves.size();
+	for (uint32_t i = 0; i < size; ++i)
+		if (_leaves[i] != -1 && _updateStamps[i] != _updateCount)
+			_removals.push_back(i);
+
+	const bool rebuild = _settings.rebuildInterval > 0 && _updateCount % _settings.rebuildInterval == 0;
+
+	// The exact bounds change every frame, even when the tree doesn't.
+	std::unique_lock lock(_mutex);
+	_bounds.swap(_nextBounds);
+	if (_changes.empty() && _removals.empty() && !rebuild)
+		return;
+
+	for (const auto& sparseId : _removals)
+	{
+		const int32_t leaf = _leaves[sparseId];
+		RemoveLeaf(leaf);
+		FreeNode(leaf);
+		_leaves[sparseId] = -1;
+	}
+
+	const glm::vec3 margin{ _settings.margin };
+	for (const auto& [sparseId, aabb] : _changes)
+	{
+		int32_t leaf = _leaves[sparseId];
+		if (leaf == -1)
+		{
+			leaf = AllocateNode();
+			_leaves[sparseId] = leaf;
+		}
+		else
+			RemoveLeaf(leaf);
+
+		auto& node = _nodes[leaf];
+		node.SetAabb({ aabb.min - margin, aabb.max + margin });
+		node.sparseId = sparseId;
+		InsertLeaf(leaf);
+	}
+
+	if (rebuild)
+		BuildTree();
+}
+
+void AabbTree::Rebuild()
+{
+	std::unique_lock lock(_mutex);
+	BuildTree();
+}
+
+void AabbTree::QueryAabb(const Aabb& aabb, std::vector<uint32_t>& outSparseIds) const
+{
+	const auto min = simd::Float4::Load(&glm::vec4(aabb.min, 0)[0]);
+	const auto max = simd::Float4::Load(&glm::vec4(aabb.max, 0)[0]);
+
+	Traverse([&](const float* nodeMin, const float* nodeMax)
+	{
+		return (simd::LessThan(simd::Float4::Load(nodeMax), min) | simd::LessThan(max, simd::Float4::Load(nodeMin))) == 0;
+	}, [&](const Node& node)
+	{
+		outSparseIds.push_back(node.sparseId);
+	});
+}
+
+void AabbTree::QuerySphere(const glm::vec3& center, const float radius, std::vector<uint32_t>& outSparseIds) const
+{
+	const auto simdCenter = simd::Float4::Load(&glm::vec4(center, 0)[0]);
+	const float radiusSquared = radius * radius;
+
+	Traverse([&](const float* min, const float* max)
+	{
+		// Distance to the closest point in the box.
+		const auto closest = simd::Min(simd::Max(simdCenter, simd::Float4::Load(min)), simd::Float4::Load(max));
+		const auto offset = simdCenter - closest;
+
+		float squared[4];
+		(offset * offset).Store(squared);
+		return squared[0] + squared[1] + squared[2] <= radiusSquared;
+	}, [&](const Node& node)
+	{
+		outSparseIds.push_back(node.sparseId);
+	});
+}
+
+void AabbTree::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& outSparseIds) const
+{
+	// Planes in SoA form, so that four planes can be tested at once.
+	// The last two lanes are padded with planes that contain everything.
+	float planes[7][8]{};
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		const glm::vec4 plane = i < 6 ? frustum.planes[i] : glm::vec4(0, 0, 0, 1);
+		for (uint32_t j = 0; j < 3; ++j)
+		{
+			planes[j][i] = plane[j];
+			planes[3 + j][i] = std::abs(plane[j]);
+		}
+		planes[6][i] = plane.w;
+	}
+
+	simd::Float4 simdPlanes[7][2];
+	for (uint32_t i = 0; i < 7; ++i)
+		for (uint32_t j = 0; j < 2; ++j)
+			simdPlanes[i][j] = simd::Float4::Load(&planes[i][j * 4]);
+
+	const auto zero = simd::Float4::Splat(0);
+
+	Traverse([&](const float* min, const float* max)
+	{
+		float center[3];
+		float extents[3];
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			center[i] = (min[i] + max[i]) * .5f;
+			extents[i] = (max[i] - min[i]) * .5f;
+		}
+
+		// The box is outside if it's fully behind one of the planes.
+		for (uint32_t p = 0; p < 2; ++p)
+		{
+			auto distance = simdPlanes[6][p];
+			for (uint32_t i = 0; i < 3; ++i)
+				distance = distance + simdPlanes[i][p] * simd::Float4::Splat(center[i]) +
+					simdPlanes[3 + i][p] * simd::Float4::Splat(extents[i]);
+			if (simd::LessThan(distance, zero))
+				return false;
+		}
+
+		return true;
+	}, [&](const Node& node)
+	{
+		outSparseIds.push_back(node.sparseId);
+	});
+}
+
+bool AabbTree::Raycast(const glm::vec3& origin, const glm::vec3& direction, const float maxDistance,
+	uint32_t& outSparseId, float& outDistance) const
+{
+	const auto simdOrigin = simd::Float4::Load(&glm::vec4(origin, 0)[0]);
+	const auto inverse = simd::Float4::Load(&glm::vec4(1.f / direction, 0)[0]);
+
+	bool hit = false;
+	float closest = maxDistance;
+	float enter = 0;
+
+	Traverse([&](const float* min, const float* max)
+	{
+		// Slab test, where the ray enters the box when it has entered all three slabs.
+		// Leaves are tested with their exact bounds last, so the distance is the one to the entity.
+		const auto a = (simd::Float4::Load(min) - simdOrigin) * inverse;
+		const auto b = (simd::Float4::Load(max) - simdOrigin) * inverse;
+
+		float entries[4];
+		float exits[4];
+		simd::Min(a, b).Store(entries);
+		simd::Max(a, b).Store(exits);
+
+		enter = std::max(std::max(entries[0], entries[1]), std::max(entries[2], 0.f));
+		const float exit = std::min(std::min(exits[0], exits[1]), std::min(exits[2], closest));
+		return enter <= exit;
+	}, [&](const Node& node)
+	{
+		hit = true;
+		closest = enter;
+		outSparseId = node.sparseId;
+	});
+
+	outDistance = closest;
+	return hit;
+}
+
+int32_t AabbTree::AllocateNode()
+{
+	if (_freeNodes.empty())
+	{
+		_nodes.emplace_back();
+		return _nodes.size() - 1;
+	}
+
+	const int32_t index = _freeNodes.back();
+	_freeNodes.pop_back();
+	_nodes[index] = {};
+	return index;
+}
+
+void AabbTree::FreeNode(const int32_t index)
+{
+	_freeNodes.push_back(index);
+}
+
+void AabbTree::InsertLeaf(const int32_t leaf)
+{
+	if (_root == -1)
+	{
+		_root = leaf;
+		_nodes[leaf].parent = -1;
+		return;
+	}
+
+	// Find the sibling that increases the surface area of the tree the least.
+	const Aabb leafAabb = _nodes[leaf].GetAabb();
+	int32_t index = _root;
+
+	while (!_nodes[index].IsLeaf())
+	{
+		const auto& node = _nodes[index];
+		const float area = node.GetAabb().GetSurfaceArea();
+		const float combinedArea = Aabb::Combine(node.GetAabb(), leafAabb).GetSurfaceArea();
+
+		// Cost of pairing with this node, and the cost of pushing the leaf further down.
+		const float cost = 2 * combinedArea;
+		const float inheritedCost = 2 * (combinedArea - area);
+
+		float childCosts[2];
+		for (uint32_t i = 0; i < 2; ++i)
+		{
+			const auto& child = _nodes[node.children[i]];
+			const Aabb childAabb = child.GetAabb();
+			const float childArea = Aabb::Combine(childAabb, leafAabb).GetSurfaceArea();
+			childCosts[i] = (child.IsLeaf() ? childArea : childArea - childAabb.GetSurfaceArea()) + inheritedCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+			break;
+
+		index = node.children[childCosts[0] < childCosts[1] ? 0 : 1];
+	}
+
+	const int32_t sibling = index;
+	const int32_t oldParent = _nodes[sibling].parent;
+	const int32_t newParent = AllocateNode();
+
+	auto& parent = _nodes[newParent];
+	parent.parent = oldParent;
+	parent.children[0] = sibling;
+	parent.children[1] = leaf;
+	_nodes[sibling].parent = newParent;
+	_nodes[leaf].parent = newParent;
+
+	if (oldParent == -1)
+		_root = newParent;
+	else
+	{
+		auto& children = _nodes[oldParent].children;
+		children[children[0] == sibling ? 0 : 1] = newParent;
+	}
+
+	Refit(newParent);
+}
+
+void AabbTree::RemoveLeaf(const int32_t leaf)
+{
+	if (leaf == _root)
+	{
+		_root = -1;
+		return;
+	}
+
+	const int32_t parent = _nodes[leaf].parent;
+	const int32_t grandParent = _nodes[parent].parent;
+	const auto& children = _nodes[parent].children;
+	const int32_t sibling = children[children[0] == leaf ? 1 : 0];
+
+	_nodes[sibling].parent = grandParent;
+	FreeNode(parent);
+
+	if (grandParent == -1)
+	{
+		_root = sibling;
+		return;
+	}
+
+	auto& grandChildren = _nodes[grandParent].children;
+	grandChildren[grandChildren[0] == parent ? 0 : 1] = sibling;
+	Refit(grandParent);
+}
+
+void AabbTree::Refit(int32_t index)
+{
+	while (index != -1)
+	{
+		auto& node = _nodes[index];
+		node.SetAabb(Aabb::Combine(_nodes[node.children[0]].GetAabb(), _nodes[node.children[1]].GetAabb()));
+		index = node.parent;
+	}
+}
+
+void AabbTree::BuildTree()
+{
+	if (_root == -1)
+		return;
+
+	// Free the branches, and collect the leaves.
+	_buildNodes.clear();
+	std::vector<int32_t> stack{ _root };
+	while (!stack.empty())
+	{
+		const int32_t index = stack.back();
+		stack.pop_back();
+
+		const auto& node = _nodes[index];
+		if (node.IsLeaf())
+		{
+			_buildNodes.push_back(index);
+			continue;
+		}
+
+		stack.push_back(node.children[0]);
+		stack.push_back(node.children[1]);
+		FreeNode(index);
+	}
+
+	_root = Build(_buildNodes.data(), _buildNodes.size());
+	_nodes[_root].parent = -1;
+}
+
+int32_t AabbTree::Build(int32_t* leaves, const uint32_t count)
+{
+	if (count == 1)
+		return leaves[0];
+
+	// Split at the median of the longest axis.
+	Aabb centers{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const Aabb aabb = _nodes[leaves[i]].GetAabb();
+		const glm::vec3 center = (aabb.min + aabb.max) * .5f;
+		centers = Aabb::Combine(centers, { center, center });
+	}
+
+	const glm::vec3 size = centers.max - centers.min;
+	const uint32_t axis = size.x > size.y ? size.x > size.z ? 0 : 2 : size.y > size.z ? 1 : 2;
+	const uint32_t half = count / 2;
+
+	std::nth_element(leaves, leaves + half, leaves + count, [this, axis](const int32_t a, const int32_t b)
+	{
+		return _nodes[a].min[axis] + _nodes[a].max[axis] < _nodes[b].min[axis] + _nodes[b].max[axis];
+	});
+
+	const int32_t left = Build(leaves, half);
+	const int32_t right = Build(leaves + half, count - half);
+	const int32_t index = AllocateNode();
+
+	auto& node = _nodes[index];
+	node.children[0] = left;
+	node.children[1] = right;
+	node.SetAabb(Aabb::Combine(_nodes[left].GetAabb(), _nodes[right].GetAabb()));
+	_nodes[left].parent = index;
+	_nodes[right].parent = index;
+	return index;
+}
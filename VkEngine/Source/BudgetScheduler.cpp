@@ -0,0 +1,114 @@
+﻿#include "pch.h"
+#include "BudgetScheduler.h"
+
+BudgetScheduler::BudgetScheduler() : BudgetScheduler(Settings())
+{
+}
+
+BudgetScheduler::BudgetScheduler(const Settings& settings) : _settings(settings)
+{
+}
+
+uint32_t BudgetScheduler::Add(const std::string& name, const Task& task)
+{
+	uint32_t id = static_cast<uint32_t>(_tasks.size());
+	if (_freeIds.empty())
+	{
+		_tasks.emplace_back();
+		_stats.emplace_back();
+	}
+	else
+	{
+		id = _freeIds.back();
+		_freeIds.pop_back();
+	}
+
+	_tasks[id] = task;
+	_stats[id] = {};
+	_stats[id].name = name;
+	return id;
+}
+
+void BudgetScheduler::Remove(const uint32_t id)
+{
+	assert(_tasks[id]);
+	_tasks[id] = nullptr;
+	_freeIds.push_back(id);
+}
+
+void BudgetScheduler::Run()
+{
+	Run(_settings.budget);
+}
+
+void BudgetScheduler::Run(const uint32_t budget)
+{
+	using Clock = std::chrono::steady_clock;
+	using Microseconds = std::chrono::duration<float, std::micro>;
+
+	for (auto& stats : _stats)
+	{
+		stats.frameSteps = 0;
+		stats.frameMicroseconds = 0;
+	}
+
+	const auto count = static_cast<uint32_t>(_tasks.size());
+	const auto start = Clock::now();
+	auto time = start;
+	float elapsed = 0;
+
+	// Removed tasks leave an empty slot behind, which counts as finished.
+	uint32_t finished = 0;
+	_finished.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		_finished[i] = !_tasks[i];
+		finished += _finished[i];
+	}
+
+	// Tasks take turns doing a step, so that a task with a lot of work doesn't starve the others.
+	while (finished < count && elapsed < budget)
+	{
+		_cursor = (_cursor + 1) % count;
+		if (_finished[_cursor])
+			continue;
+
+		auto& stats = _stats[_cursor];
+		const bool pending = _tasks[_cursor]();
+
+		const auto stepTime = Clock::now();
+		const float step = Microseconds(stepTime - time).count();
+		time = stepTime;
+		elapsed = Microseconds(time - start).count();
+
+		stats.steps++;
+		stats.microseconds += step;
+		stats.frameSteps++;
+		stats.frameMicroseconds += step;
+		stats.maxStepMicroseconds = std::max(stats.maxStepMicroseconds, step);
+		stats.pending = pending;
+
+		if (pending)
+			continue;
+
+		_finished[_cursor] = true;
+		finished++;
+	}
+
+	_frameMicroseconds = elapsed;
+}
+
+const BudgetScheduler::Stats& BudgetScheduler::GetStats(const uint32_t id) const
+{
+	return _stats[id];
+}
+
+uint32_t BudgetScheduler::GetTaskCount() const
+{
+	return static_cast<uint32_t>(_tasks.size());
+}
+
+float BudgetScheduler::GetFrameMicroseconds() const
+{
+	return _frameMicroseconds;
+}
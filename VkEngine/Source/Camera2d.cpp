@@ -7,6 +7,17 @@ Camera2d::System::System(const uint32_t size) : CameraSystem<Camera2d, Ubo>(size
 {
 }
 
+glm::vec4 Camera2d::System::GetViewRect(const uint32_t sparseId)
+{
+	const Ubo ubo = CreateUbo((*this)[sparseId], sparseId);
+
+	// Matches the camera transformation in the 2d vertex shader.
+	const float zoom = 1 + ubo.position.z;
+	const glm::vec2 extents{ zoom, zoom / ubo.aspectRatio };
+	const glm::vec2 center = ubo.position;
+	return glm::vec4(center - extents, center + extents);
+}
+
 Camera2d::Ubo Camera2d::System::CreateUbo(Camera2d& camera, const uint32_t index)
 {
 	auto& renderSystem = RenderSystem::Instance::Get();
@@ -15,11 +26,12 @@ Camera2d::Ubo Camera2d::System::CreateUbo(Camera2d& camera, const uint32_t index
 	const auto resolution = windowSystem.GetVkInfo().resolution;
 	const float aspectRatio = static_cast<float>(resolution.x) / resolution.y;
 
+	// Use the baked position, which is interpolated between ticks.
 	auto& transforms = Transform2d::System::Instance::Get();
-	auto& transform = transforms[index];
+	const auto& bake = transforms.GetSets()[0].Get<Transform2d::Baked>(transforms.GetDenseId(index));
 
 	Ubo ubo{};
-	ubo.position = glm::vec3(transform.position, camera.depth);
+	ubo.position = glm::vec3(bake.model[2], camera.depth);
 	ubo.aspectRatio = aspectRatio;
 
 	return ubo;
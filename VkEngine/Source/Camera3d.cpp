@@ -7,6 +7,12 @@ Camera3d::System::System(const uint32_t size) : CameraSystem<Camera3d, Ubo>(size
 {
 }
 
+glm::mat4 Camera3d::System::GetViewProjection(const uint32_t sparseId)
+{
+	const Ubo ubo = CreateUbo((*this)[sparseId], sparseId);
+	return ubo.projection * ubo.view;
+}
+
 Camera3d::Ubo Camera3d::System::CreateUbo(Camera3d& camera, const uint32_t index)
 {
 	auto& renderSystem = RenderSystem::Instance::Get();
@@ -15,11 +21,13 @@ Camera3d::Ubo Camera3d::System::CreateUbo(Camera3d& camera, const uint32_t index
 	const auto resolution = windowSystem.GetVkInfo().resolution;
 	const float aspectRatio = static_cast<float>(resolution.x) / resolution.y;
 
+	// Use the baked position, which is interpolated between ticks.
 	auto& transforms = Transform3d::System::Instance::Get();
-	auto& transform = transforms[index];
+	const auto& bake = transforms.GetSets()[0].Get<Transform3d::Baked>(transforms.GetDenseId(index));
+	const glm::vec3 position = bake.model[3];
 
 	Ubo ubo{};
-	ubo.view = glm::lookAt(transform.position, camera.lookat, glm::vec3(0, 1, 0));
+	ubo.view = glm::lookAt(position, camera.lookat, glm::vec3(0, 1, 0));
 	ubo.projection = glm::perspective(glm::radians(camera.fieldOfView),
 		aspectRatio, camera.clipNear, camera.clipFar);
 
@@ -3,7 +3,7 @@
 
 namespace ce
 {
-	Cecsar::Cecsar(const uint32_t size) : _entities(size)
+	Cecsar::Cecsar(const uint32_t size, std::pmr::memory_resource* resource) : _entities(size, resource)
 	{
 		
 	}
@@ -34,6 +34,35 @@ namespace ce
 		_openPq.emplace(index);
 	}
 
+	void Cecsar::Instantiate(const Prefab& prefab, const uint32_t count, std::vector<Entity>& outEntities)
+	{
+		_instantiateIds.resize(count);
+		outEntities.reserve(outEntities.size() + count);
+
+		// Reuse open slots first, the remainder is appended behind the last entity.
+		uint32_t index = _entities.GetCount() + static_cast<uint32_t>(_openPq.size());
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			uint32_t sparseId = index;
+			if (!_openPq.empty())
+			{
+				sparseId = _openPq.top();
+				_openPq.pop();
+			}
+			else
+				index++;
+
+			_instantiateIds[i] = sparseId;
+			outEntities.push_back({ static_cast<int32_t>(sparseId), _globalId++ });
+		}
+
+		const auto begin = outEntities.end() - count;
+		for (uint32_t i = 0; i < count; ++i)
+			_entities.Insert(_instantiateIds[i]) = begin[i];
+
+		prefab.Instantiate(_instantiateIds.data(), count);
+	}
+
 	void Cecsar::AddSet(Set* set)
 	{
 		_sets.push_back(set);
@@ -0,0 +1,53 @@
+﻿#include "pch.h"
+#include "FrameDriver.h"
+
+FrameDriver::FrameDriver() : FrameDriver(Settings())
+{
+}
+
+FrameDriver::FrameDriver(const Settings& settings) : _settings(settings)
+{
+	assert(settings.tickRate > 0);
+	assert(settings.maxTicksPerFrame > 0);
+
+	_tickDelta = 1.0 / settings.tickRate;
+	_previousTime = std::chrono::steady_clock::now();
+}
+
+void FrameDriver::BeginFrame()
+{
+	const auto time = std::chrono::steady_clock::now();
+	_accumulator += std::chrono::duration<double>(time - _previousTime).count();
+	_previousTime = time;
+
+	const double ticks = std::floor(_accumulator / _tickDelta);
+	_accumulator -= ticks * _tickDelta;
+
+	// Drop the ticks that can't be caught up on, instead of falling further behind every frame.
+	_pendingTicks = static_cast<uint32_t>(std::min(ticks, static_cast<double>(_settings.maxTicksPerFrame)));
+}
+
+bool FrameDriver::Tick()
+{
+	if (_pendingTicks == 0)
+		return false;
+
+	_pendingTicks--;
+	_tickCount++;
+	return true;
+}
+
+float FrameDriver::GetAlpha() const
+{
+	return static_cast<float>(std::min(_accumulator / _tickDelta, 1.0));
+}
+
+float FrameDriver::GetTickDelta() const
+{
+	return static_cast<float>(_tickDelta);
+}
+
+uint64_t FrameDriver::GetTickCount() const
+{
+	return _tickCount;
+}
@@ -0,0 +1,159 @@
+﻿#include "pch.h"
+#include "MaterialCache.h"
+#include "RenderSystem.h"
+#include "Singleton.h"
+
+bool MaterialCache::Key::operator==(const Key& other) const
+{
+	return imageView == other.imageView && filter == other.filter;
+}
+
+void MaterialCache::Construct(const VkDescriptorSetLayout layout, const uint32_t frameCount)
+{
+	Construct(layout, frameCount, Settings());
+}
+
+void MaterialCache::Construct(const VkDescriptorSetLayout layout, const uint32_t frameCount, const Settings& settings)
+{
+	_settings = settings;
+	_layout = layout;
+	_frameCount = frameCount;
+}
+
+void MaterialCache::Cleanup()
+{
+	auto& renderSystem = RenderSystem::Instance::Get();
+	auto& renderer = renderSystem.GetVkRenderer();
+
+	// Released materials keep their sampler until they are reused.
+	for (const auto& material : _materials)
+		renderer.DestroySampler(material.sampler);
+	for (const auto& descriptorPool : _descriptorPools)
+		renderer.DestroyDescriptorPool(descriptorPool);
+	renderer.DestroyLayout(_layout);
+
+	_materials.clear();
+	_handles.clear();
+	_freeHandles.clear();
+	_releasedMaterials.clear();
+	_pendingSets.clear();
+	_pendingImageViews.clear();
+	_pendingSamplers.clear();
+	_descriptorPools.clear();
+	_remainingSetsInPool = 0;
+}
+
+void MaterialCache::Update()
+{
+	_frame++;
+
+	// Materials are released in order, so the front of the queue is always the first one to be safe to reuse.
+	while (!_releasedMaterials.empty() && _releasedMaterials.front().frame <= _frame)
+	{
+		_freeHandles.push_back(_releasedMaterials.front().handle);
+		_releasedMaterials.pop_front();
+	}
+}
+
+uint32_t MaterialCache::Acquire(const Key& key)
+{
+	const auto found = _handles.find(key);
+	if (found != _handles.end())
+	{
+		_materials[found->second].refCount++;
+		return found->second;
+	}
+
+	auto& renderSystem = RenderSystem::Instance::Get();
+	auto& renderer = renderSystem.GetVkRenderer();
+
+	uint32_t handle;
+	if (_freeHandles.empty())
+	{
+		if (_remainingSetsInPool == 0)
+		{
+			VkDescriptorType type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			_descriptorPools.push_back(renderer.CreateDescriptorPool(&type, 1, _settings.poolSize));
+			_remainingSetsInPool = _settings.poolSize;
+		}
+		_remainingSetsInPool--;
+
+		handle = static_cast<uint32_t>(_materials.size());
+		auto& material = _materials.emplace_back();
+		renderer.CreateDescriptorSets(_descriptorPools.back(), _layout, &material.descriptorSet, 1);
+	}
+	else
+	{
+		handle = _freeHandles.back();
+		_freeHandles.pop_back();
+		renderer.DestroySampler(_materials[handle].sampler);
+	}
+
+	auto& material = _materials[handle];
+	material.key = key;
+	material.sampler = renderer.CreateSampler(key.filter, key.filter);
+	material.refCount = 1;
+
+	// New sets and sets that are reused are not in use by any frame, so they can be written later on in one go.
+	_pendingSets.push_back(material.descriptorSet);
+	_pendingImageViews.push_back(key.imageView);
+	_pendingSamplers.push_back(material.sampler);
+
+	_handles.emplace(key, handle);
+	return handle;
+}
+
+void MaterialCache::Release(const uint32_t handle)
+{
+	auto& material = _materials[handle];
+	assert(material.refCount > 0);
+	if (--material.refCount > 0)
+		return;
+
+	// The set can still be in use by the frames in flight, and the render thread is a frame behind.
+	_handles.erase(material.key);
+	_releasedMaterials.push_back({ handle, _frame + _frameCount + 2 });
+}
+
+void MaterialCache::Assign(uint32_t& handle, const Key& key)
+{
+	if (handle != invalidHandle && _materials[handle].key == key)
+		return;
+
+	// Acquiring first keeps the material alive when the handle already points to it.
+	const uint32_t previous = handle;
+	handle = Acquire(key);
+	if (previous != invalidHandle)
+		Release(previous);
+}
+
+void MaterialCache::Flush()
+{
+	if (_pendingSets.empty())
+		return;
+
+	auto& renderSystem = RenderSystem::Instance::Get();
+	auto& renderer = renderSystem.GetVkRenderer();
+
+	renderer.BindSamplers(_pendingSets.data(), _pendingImageViews.data(), _pendingSamplers.data(),
+		static_cast<uint32_t>(_pendingSets.size()), 0, 0);
+
+	_pendingSets.clear();
+	_pendingImageViews.clear();
+	_pendingSamplers.clear();
+}
+
+const MaterialCache::Material& MaterialCache::operator[](const uint32_t handle) const
+{
+	return _materials[handle];
+}
+
+uint32_t MaterialCache::GetCount() const
+{
+	return static_cast<uint32_t>(_handles.size());
+}
+
+size_t MaterialCache::KeyHash::operator()(const Key& key) const
+{
+	return std::hash<VkImageView>()(key.imageView) ^ std::hash<uint32_t>()(key.filter) << 1;
+}
\ No newline at end of file
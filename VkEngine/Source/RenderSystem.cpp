@@ -3,19 +3,26 @@
 #include "VkRenderer/WindowSystemGLFW.h"
 #include "VkRenderer/VkRenderer.h"
 #include "VkRenderer/RenderPassInfo.h"
+#include "VkRenderer/DescriptorLayoutInfo.h"
 #include "TextureLoader.h"
 #include "DepthBuffer.h"
 
-RenderSystem::RenderSystem()
+RenderSystem::RenderSystem() : RenderSystem(Settings())
+{
+
+}
+
+RenderSystem::RenderSystem(const Settings& settings) : _settings(settings)
 {
 	vi::WindowSystemGLFW::VkInfo windowInfo{};
 	windowInfo.name = "Prototype Game";
 	windowInfo.resolution = {800, 600};
 	_windowSystem = new vi::WindowSystemGLFW(windowInfo);
 
-	vi::VkRenderer::Settings settings;
-	settings.debugger.validationLayers.push_back("VK_LAYER_RENDERDOC_Capture");
-	_vkRenderer.Construct(*_windowSystem, settings);
+	vi::VkRenderer::Settings vkSettings;
+	vkSettings.debugger.validationLayers.push_back("VK_LAYER_RENDERDOC_Capture");
+	vkSettings.descriptorIndexing = settings.bindlessTextures;
+	_vkRenderer.Construct(*_windowSystem, vkSettings);
 
 	_swapChain.Construct(_vkRenderer);
 
@@ -27,26 +34,61 @@ RenderSystem::RenderSystem()
 	_renderPass = _vkRenderer.CreateRenderPass(renderPassInfo);
 
 	_swapChain.SetRenderPass(_renderPass);
+	_uniformRing.Construct(_vkRenderer, _swapChain.GetImageCount());
+	_uploads.Construct(_vkRenderer, _swapChain.GetImageCount(), _settings.uploads);
+
+	if (!_settings.bindlessTextures)
+		return;
+
+	// Unused slots are never read, so the array doesn't have to be filled.
+	vi::BindingInfo bindingInfo{};
+	bindingInfo.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindingInfo.count = _settings.maxBindlessTextures;
+	bindingInfo.flag = VK_SHADER_STAGE_FRAGMENT_BIT;
+	bindingInfo.bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+
+	vi::DescriptorLayoutInfo layoutInfo{};
+	layoutInfo.bindings.push_back(bindingInfo);
+	_bindlessLayout = _vkRenderer.CreateLayout(layoutInfo);
+
+	VkDescriptorType type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	_bindlessPool = _vkRenderer.CreateDescriptorPool(&type, 1, 1, _settings.maxBindlessTextures,
+		VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT);
+	_vkRenderer.CreateDescriptorSets(_bindlessPool, _bindlessLayout, &_bindlessSet, 1);
+	_bindlessSampler = _vkRenderer.CreateSampler();
 }
 
 RenderSystem::~RenderSystem()
 {
+	if (_settings.bindlessTextures)
+	{
+		_vkRenderer.DestroySampler(_bindlessSampler);
+		_vkRenderer.DestroyDescriptorPool(_bindlessPool);
+		_vkRenderer.DestroyLayout(_bindlessLayout);
+	}
+
+	_uploads.Cleanup();
+	_uniformRing.Cleanup();
 	_swapChain.Cleanup();
 	_vkRenderer.DestroyRenderPass(_renderPass);
 	_vkRenderer.Cleanup();
 	delete _windowSystem;
 }
 
-void RenderSystem::BeginFrame(bool* quit)
+void RenderSystem::PollEvents(bool* quit)
 {
 	_windowSystem->BeginFrame(*quit);
-	if (*quit)
-		return;
+}
 
+void RenderSystem::BeginFrame()
+{
 	_swapChain.GetNext(_image, _frame);
+	_uniformRing.BeginFrame();
+	_uploads.BeginFrame();
 
 	const auto extent = _swapChain.GetExtent();
 	_vkRenderer.BeginCommandBufferRecording(_image.commandBuffer);
+	_uploads.Record();
 
 	VkClearValue clearColors[2];
 	clearColors[0].color = { 0, 0, 0, 1 };
@@ -59,7 +101,15 @@ void RenderSystem::EndFrame()
 {
 	_vkRenderer.EndRenderPass();
 	_vkRenderer.EndCommandBufferRecording();
-	_vkRenderer.Submit(&_image.commandBuffer, 1, _frame.imageAvailableSemaphore, _frame.renderFinishedSemaphore, _frame.inFlightFence);
+
+	// Uploads on a dedicated transfer queue have to finish before the frame uses them.
+	const auto uploadSemaphore = _uploads.GetSemaphore();
+	const VkSemaphore waitSemaphores[] = { _frame.imageAvailableSemaphore, uploadSemaphore };
+	const VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, UploadManager::waitStage };
+	_vkRenderer.Submit(&_image.commandBuffer, 1, waitSemaphores, waitStages, uploadSemaphore ? 2 : 1, 
+		_frame.renderFinishedSemaphore, _frame.inFlightFence);
+
+	_uniformRing.EndFrame();
 	const auto result = _swapChain.Present();
 	if (!result)
 	{
@@ -81,45 +131,22 @@ void RenderSystem::DestroyMesh(const Mesh& mesh)
 	_vkRenderer.FreeMemory(mesh.indexMemory);
 }
 
+bool RenderSystem::IsReady(const Mesh& mesh) const
+{
+	return _uploads.IsReady(mesh.upload);
+}
+
 Texture RenderSystem::CreateTexture(const std::string& fileName)
 {
 	int32_t w, h, d;
 	const auto tex = TextureLoader::Load("Textures/" + fileName, w, h, d);
-	const auto texStagingBuffer = _vkRenderer.CreateBuffer<unsigned char>(w * h * 4, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-	const auto texStagingMem = _vkRenderer.AllocateMemory(texStagingBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	_vkRenderer.BindMemory(texStagingBuffer, texStagingMem);
-	_vkRenderer.MapMemory(texStagingMem, tex, 0, w * h * 4);
-	TextureLoader::Free(tex);
 
 	const auto img = _vkRenderer.CreateImage({ w, h });
 	const auto imgMem = _vkRenderer.AllocateMemory(img, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 	_vkRenderer.BindMemory(img, imgMem);
 
-	auto imgCmd = _vkRenderer.CreateCommandBuffer();
-	_vkRenderer.BeginCommandBufferRecording(imgCmd);
-	_vkRenderer.TransitionImageLayout(img, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	_vkRenderer.EndCommandBufferRecording();
-
-	const auto imgFence = _vkRenderer.CreateFence();
-	_vkRenderer.Submit(&imgCmd, 1, VK_NULL_HANDLE, VK_NULL_HANDLE, imgFence);
-	_vkRenderer.WaitForFence(imgFence);
-
-	_vkRenderer.BeginCommandBufferRecording(imgCmd);
-	_vkRenderer.CopyBuffer(texStagingBuffer, img, w, h);
-	_vkRenderer.EndCommandBufferRecording();
-	_vkRenderer.Submit(&imgCmd, 1, VK_NULL_HANDLE, VK_NULL_HANDLE, imgFence);
-	_vkRenderer.WaitForFence(imgFence);
-
-	_vkRenderer.BeginCommandBufferRecording(imgCmd);
-	_vkRenderer.TransitionImageLayout(img, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-	_vkRenderer.EndCommandBufferRecording();
-	_vkRenderer.Submit(&imgCmd, 1, VK_NULL_HANDLE, VK_NULL_HANDLE, imgFence);
-	_vkRenderer.WaitForFence(imgFence);
-
-	_vkRenderer.DestroyFence(imgFence);
-	_vkRenderer.DestroyCommandBuffer(imgCmd);
-	_vkRenderer.DestroyBuffer(texStagingBuffer);
-	_vkRenderer.FreeMemory(texStagingMem);
+	const auto upload = _uploads.Upload(img, { w, h }, tex, w * h * 4);
+	TextureLoader::Free(tex);
 
 	const auto imgView = _vkRenderer.CreateImageView(img);
 
@@ -129,17 +156,43 @@ Texture RenderSystem::CreateTexture(const std::string& fileName)
 	texture.image = img;
 	texture.imageMemory = imgMem;
 	texture.imageView = imgView;
+	texture.upload = upload;
+
+	if (_settings.bindlessTextures)
+	{
+		if (_freeTextureIndices.empty())
+		{
+			assert(_textureIndexCount < _settings.maxBindlessTextures);
+			texture.index = _textureIndexCount++;
+		}
+		else
+		{
+			texture.index = _freeTextureIndices.back();
+			_freeTextureIndices.pop_back();
+		}
+
+		_vkRenderer.BindSampler(_bindlessSet, imgView, _bindlessSampler, 0, texture.index);
+	}
 
 	return texture;
 }
 
 void RenderSystem::DestroyTexture(const Texture& texture)
 {
+	// The slot keeps pointing at the destroyed view, but partially bound slots are only invalid when read.
+	if (_settings.bindlessTextures)
+		_freeTextureIndices.push_back(texture.index);
+
 	_vkRenderer.DestroyImageView(texture.imageView);
 	_vkRenderer.DestroyImage(texture.image);
 	_vkRenderer.FreeMemory(texture.imageMemory);
 }
 
+bool RenderSystem::IsReady(const Texture& texture) const
+{
+	return _uploads.IsReady(texture.upload);
+}
+
 DepthBuffer RenderSystem::CreateDepthBuffer(const glm::ivec2 resolution)
 {
 	const auto format = _vkRenderer.GetDepthBufferFormat();
@@ -167,7 +220,7 @@ DepthBuffer RenderSystem::CreateDepthBuffer(const glm::ivec2 resolution)
 	return depthBuffer;
 }
 
-void RenderSystem::DestroyDepthBuffer(DepthBuffer& depthBuffer) const
+void RenderSystem::DestroyDepthBuffer(DepthBuffer& depthBuffer)
 {
 	_vkRenderer.DestroyImageView(depthBuffer.imageView);
 	_vkRenderer.DestroyImage(depthBuffer.image);
@@ -188,3 +241,23 @@ vi::SwapChain& RenderSystem::GetSwapChain()
 {
 	return _swapChain;
 }
+
+UniformRing& RenderSystem::GetUniformRing()
+{
+	return _uniformRing;
+}
+
+bool RenderSystem::IsBindless() const
+{
+	return _settings.bindlessTextures;
+}
+
+VkDescriptorSetLayout RenderSystem::GetBindlessLayout() const
+{
+	return _bindlessLayout;
+}
+
+VkDescriptorSet RenderSystem::GetBindlessSet() const
+{
+	return _bindlessSet;
+}
@@ -0,0 +1,96 @@
+﻿#include "pch.h"
+#include "RenderThread.h"
+#include "RenderSystem.h"
+
+RenderThread::RenderThread()
+{
+	_thread = std::thread(&RenderThread::Run, this);
+}
+
+RenderThread::~RenderThread()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+
+	_condition.notify_all();
+	_thread.join();
+}
+
+void RenderThread::AddPass(const Pass& pass)
+{
+	assert(_submittedFrames == 0);
+	_passes.push_back(pass);
+}
+
+void RenderThread::Submit()
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		// With only two packets the render thread can't fall more than a frame behind.
+		_condition.wait(lock, [this]
+		{
+			return _renderedFrames == _submittedFrames;
+		});
+		_submittedFrames++;
+	}
+
+	_condition.notify_all();
+}
+
+void RenderThread::Flush()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_condition.wait(lock, [this]
+	{
+		return _renderedFrames == _submittedFrames;
+	});
+}
+
+uint32_t RenderThread::GetPacketIndex() const
+{
+	return _submittedFrames % packetCount;
+}
+
+uint32_t RenderThread::GetFrameSlot() const
+{
+	auto& renderSystem = RenderSystem::Instance::Get();
+	return _submittedFrames % renderSystem.GetSwapChain().GetImageCount();
+}
+
+void RenderThread::Run()
+{
+	auto& renderSystem = RenderSystem::Instance::Get();
+
+	while (true)
+	{
+		uint64_t frame;
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this]
+			{
+				return _quit || _renderedFrames < _submittedFrames;
+			});
+
+			// Finish the submitted frames before quitting.
+			if (_renderedFrames == _submittedFrames)
+				return;
+			frame = _renderedFrames;
+		}
+
+		renderSystem.BeginFrame();
+		for (auto& pass : _passes)
+			pass(frame % packetCount);
+		renderSystem.EndFrame();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_renderedFrames++;
+		}
+
+		_condition.notify_all();
+	}
+}
@@ -0,0 +1,216 @@
+﻿#include "pch.h"
+#include "SpatialHash2d.h"
+#include "Transform2d.h"
+#include "Mesh.h"
+
+SpatialHash2d::SpatialHash2d(const uint32_t size) : SpatialHash2d(size, Settings())
+{
+}
+
+SpatialHash2d::SpatialHash2d(const uint32_t size, const Settings& settings) :
+	_settings(settings), _threadCount(std::max(settings.threadCount, 1u)), _workers(_threadCount)
+{
+	// Aim for about two cells per transform, so that most cells hold a handful of entries.
+	_cellCount = settings.cellCount;
+	if (_cellCount == 0)
+	{
+		_cellCount = 1;
+		while (_cellCount < size * 2)
+			_cellCount <<= 1;
+	}
+
+	assert((_cellCount & (_cellCount - 1)) == 0);
+
+	_bounds.resize(size);
+	_threadOffsets.resize(_threadCount);
+	_histograms.resize(_threadCount * radixSize);
+	_cellStarts.resize(_cellCount + 1);
+	_threadPairs.resize(_threadCount);
+}
+
+void SpatialHash2d::Update()
+{
+	auto& transforms = Transform2d::System::Instance::Get();
+	auto& meshes = Mesh::System::Instance::Get();
+	const auto bakes = transforms.GetSets()[0].Get<Transform2d::Baked>();
+
+	const uint32_t count = transforms.GetCount();
+
+	// Calculate the bounds and count how many entries every chunk of transforms adds.
+	_workers.ParallelFor(count, [&](const uint32_t begin, const uint32_t end, const uint32_t thread)
+	{
+		uint32_t entryCount = 0;
+
+		for (uint32_t denseId = begin; denseId < end; ++denseId)
+		{
+			const uint32_t sparseId = transforms.GetSparseId(denseId);
+			const auto& model = bakes[denseId].model;
+
+			// Meshes default to a quad between -1 and 1.
+			glm::vec2 localMin{ -1 };
+			glm::vec2 localMax{ 1 };
+			if (meshes.Contains(sparseId))
+			{
+				const auto& mesh = meshes[sparseId];
+				localMin = glm::vec2(mesh.boundsMin);
+				localMax = glm::vec2(mesh.boundsMax);
+			}
+
+			const glm::vec2 center = model * glm::vec3((localMin + localMax) * .5f, 1);
+			const glm::vec2 extents = (localMax - localMin) * .5f;
+			const glm::vec2 rotatedExtents = glm::abs(model[0]) * extents.x + glm::abs(model[1]) * extents.y;
+
+			_bounds[denseId] = glm::vec4(center - rotatedExtents, center + rotatedExtents);
+
+			const glm::ivec2 cells = GetCell(center + rotatedExtents) - GetCell(center - rotatedExtents) + 1;
+			entryCount += cells.x * cells.y;
+		}
+
+		_threadOffsets[thread] = entryCount;
+	});
+
+	uint32_t entryCount = 0;
+	for (auto& offset : _threadOffsets)
+	{
+		const uint32_t threadCount = offset;
+		offset = entryCount;
+		entryCount += threadCount;
+	}
+
+	_entries.resize(entryCount);
+	_sortBuffer.resize(entryCount);
+
+	// Every chunk writes its entries to its own contiguous range.
+	_workers.ParallelFor(count, [&](const uint32_t begin, const uint32_t end, const uint32_t thread)
+	{
+		Entry* entries = &_entries[_threadOffsets[thread]];
+
+		for (uint32_t denseId = begin; denseId < end; ++denseId)
+		{
+			const uint32_t sparseId = transforms.GetSparseId(denseId);
+			const auto& bounds = _bounds[denseId];
+			const glm::ivec2 minCell = GetCell({ bounds.x, bounds.y });
+			const glm::ivec2 maxCell = GetCell({ bounds.z, bounds.w });
+
+			for (int32_t x = minCell.x; x <= maxCell.x; ++x)
+				for (int32_t y = minCell.y; y <= maxCell.y; ++y)
+					*entries++ = { bounds, { x, y }, GetHash({ x, y }), sparseId };
+		}
+	});
+
+	for (uint32_t shift = 0; 1u << shift < _cellCount; shift += radixBits)
+		SortPass(shift);
+
+	// Every cell starts at the first entry with an equal or higher hash.
+	_workers.ParallelFor(entryCount + 1, [&](const uint32_t begin, const uint32_t end, uint32_t)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const uint32_t from = i == 0 ? 0 : _entries[i - 1].hash + 1;
+			const uint32_t to = i == entryCount ? _cellCount : _entries[i].hash;
+			for (uint32_t hash = from; hash <= to; ++hash)
+				_cellStarts[hash] = i;
+		}
+	});
+}
+
+void SpatialHash2d::QueryAabb(const glm::vec2& min, const glm::vec2& max, std::vector<uint32_t>& outSparseIds) const
+{
+	Query(min, max, [](const glm::vec4&)
+	{
+		return true;
+	}, outSparseIds);
+}
+
+void SpatialHash2d::QueryRadius(const glm::vec2& center, const float radius, std::vector<uint32_t>& outSparseIds) const
+{
+	const float radiusSquared = radius * radius;
+
+	Query(center - radius, center + radius, [&](const glm::vec4& bounds)
+	{
+		const glm::vec2 offset = center - glm::clamp(center, glm::vec2(bounds), glm::vec2(bounds.z, bounds.w));
+		return glm::dot(offset, offset) <= radiusSquared;
+	}, outSparseIds);
+}
+
+void SpatialHash2d::FindPairs(std::vector<std::pair<uint32_t, uint32_t>>& outPairs)
+{
+	_workers.ParallelFor(_cellCount, [&](const uint32_t begin, const uint32_t end, const uint32_t thread)
+	{
+		auto& pairs = _threadPairs[thread];
+		pairs.clear();
+
+		for (uint32_t hash = begin; hash < end; ++hash)
+			for (uint32_t i = _cellStarts[hash]; i < _cellStarts[hash + 1]; ++i)
+			{
+				const auto& a = _entries[i];
+				const auto& aBounds = a.bounds;
+
+				for (uint32_t j = i + 1; j < _cellStarts[hash + 1]; ++j)
+				{
+					const auto& b = _entries[j];
+					if (a.cell != b.cell)
+						continue;
+
+					const auto& bBounds = b.bounds;
+					if (aBounds.z < bBounds.x || aBounds.w < bBounds.y || bBounds.z < aBounds.x || bBounds.w < aBounds.y)
+						continue;
+
+					// Only the cell that contains the corner of the overlap adds the pair.
+					if (GetCell(glm::max(glm::vec2(aBounds), glm::vec2(bBounds))) != a.cell)
+						continue;
+
+					pairs.emplace_back(a.sparseId, b.sparseId);
+				}
+			}
+	});
+
+	for (const auto& pairs : _threadPairs)
+		outPairs.insert(outPairs.end(), pairs.begin(), pairs.end());
+}
+
+void SpatialHash2d::SortPass(const uint32_t shift)
+{
+	const uint32_t entryCount = static_cast<uint32_t>(_entries.size());
+	std::fill(_histograms.begin(), _histograms.end(), 0);
+
+	_workers.ParallelFor(entryCount, [&](const uint32_t begin, const uint32_t end, const uint32_t thread)
+	{
+		uint32_t* histogram = &_histograms[thread * radixSize];
+		for (uint32_t i = begin; i < end; ++i)
+			histogram[_entries[i].hash >> shift & (radixSize - 1)]++;
+	});
+
+	// Digits are sorted first, then chunks, which keeps the sort stable.
+	uint32_t offset = 0;
+	for (uint32_t digit = 0; digit < radixSize; ++digit)
+		for (uint32_t thread = 0; thread < _threadCount; ++thread)
+		{
+			auto& histogram = _histograms[thread * radixSize + digit];
+			const uint32_t digitCount = histogram;
+			histogram = offset;
+			offset += digitCount;
+		}
+
+	_workers.ParallelFor(entryCount, [&](const uint32_t begin, const uint32_t end, const uint32_t thread)
+	{
+		uint32_t* offsets = &_histograms[thread * radixSize];
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const auto& entry = _entries[i];
+			_sortBuffer[offsets[entry.hash >> shift & (radixSize - 1)]++] = entry;
+		}
+	});
+
+	std::swap(_entries, _sortBuffer);
+}
+
+glm::ivec2 SpatialHash2d::GetCell(const glm::vec2& position) const
+{
+	return glm::floor(position / _settings.cellSize);
+}
+
+uint32_t SpatialHash2d::GetHash(const glm::ivec2& cell) const
+{
+	return (static_cast<uint32_t>(cell.x) * 73856093u ^ static_cast<uint32_t>(cell.y) * 19349663u) & (_cellCount - 1);
+}
@@ -1,7 +1,28 @@
 #include "pch.h"
 #include "Transform2d.h"
 
-Transform2d::System::System(const uint32_t size) : SparseSet<Transform2d>(size)
+Transform2d::System::System(const uint32_t size) : TransformSet<Transform2d, Baked, System>(size)
 {
+}
+
+void Transform2d::System::Bake(Transform2d& transform, Baked& bake) const
+{
+	const float sin = std::sin(transform.rotation);
+	const float cos = std::cos(transform.rotation);
+	const auto& scale = transform.scale;
 
+	// Rotates first and scales afterwards.
+	bake.model = glm::mat3x2(
+		glm::vec2(scale.x * cos, scale.y * sin),
+		glm::vec2(-scale.x * sin, scale.y * cos),
+		transform.position);
 }
+
+Transform2d Transform2d::System::Interpolate(const Transform2d& previous, const Transform2d& current, const float alpha)
+{
+	Transform2d transform = current;
+	transform.position = glm::mix(previous.position, current.position, alpha);
+	transform.scale = glm::mix(previous.scale, current.scale, alpha);
+	transform.rotation = glm::mix(previous.rotation, current.rotation, alpha);
+	return transform;
+}
\ No newline at end of file
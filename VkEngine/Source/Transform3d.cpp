@@ -1,39 +1,113 @@
 ﻿#include "pch.h"
 #include "Transform3d.h"
 
-Transform3d::System::System(const uint32_t size) : SoASet<Transform3d>(size)
+void Transform3d::SetEulerRotation(const glm::vec3& degrees)
 {
-	AddSubSet<Baked>();
+	// Euler transforms used to be baked with half angles, which is kept so that scenes look the same.
+	rotation = glm::quat_cast(glm::eulerAngleXYZ(
+		glm::radians(degrees.x) / 2,
+		glm::radians(degrees.y) / 2,
+		glm::radians(degrees.z) / 2));
 }
 
-void Transform3d::System::Update()
+Transform3d::System::System(const uint32_t size) : System(size, SortSettings())
 {
-	const auto bakes = GetSets()[0].Get<Baked>();
+}
+
+Transform3d::System::System(const uint32_t size, const SortSettings& sortSettings) :
+	TransformSet<Transform3d, Baked, System>(size), _sortSettings(sortSettings)
+{
+}
+
+void Transform3d::System::Update(const float alpha)
+{
+	if (_sortSettings.enabled)
+		Sort();
+
+	TransformSet<Transform3d, Baked, System>::Update(alpha);
+}
+
+void Transform3d::System::Bake(Transform3d& transform, Baked& bake) const
+{
+	auto& model = bake.model;
+
+	model = glm::mat4_cast(transform.rotation);
+	model[0] *= transform.scale.x;
+	model[1] *= transform.scale.y;
+	model[2] *= transform.scale.z;
+	model[3] = glm::vec4(transform.position, 1);
+}
+
+Transform3d Transform3d::System::Interpolate(const Transform3d& previous, const Transform3d& current, const float alpha)
+{
+	// Blend along the shortest arc, which is close enough to a slerp between two ticks.
+	const glm::quat from = glm::dot(previous.rotation, current.rotation) < 0 ? -previous.rotation : previous.rotation;
 
-	for (const auto [instance, sparseId] : *this)
+	Transform3d transform = current;
+	transform.position = glm::mix(previous.position, current.position, alpha);
+	transform.rotation = glm::normalize(from + (current.rotation - from) * alpha);
+	transform.scale = glm::mix(previous.scale, current.scale, alpha);
+	return transform;
+}
+
+void Transform3d::System::Sort()
+{
+	// Start a new sort when the previous one has been fully applied.
+	if (_sortIndex >= _sortKeys.size())
 	{
-		const uint32_t denseId = GetDenseId(sparseId);
+		if (++_sortFrame < _sortSettings.interval)
+			return;
+		_sortFrame = 0;
 
-		auto& bake = bakes[denseId];
-		if (instance.manualBake)
+		_sortKeys.clear();
+		for (const auto [instance, sparseId] : *this)
+			_sortKeys.emplace_back(GetMortonKey(instance.position), sparseId);
+		std::sort(_sortKeys.begin(), _sortKeys.end());
+
+		_sortIndex = 0;
+		_sortDenseId = 0;
+	}
+
+	// Move the transforms to their sorted positions, a few at a time.
+	uint32_t swaps = 0;
+	while (_sortIndex < _sortKeys.size() && swaps < _sortSettings.swapsPerFrame)
+	{
+		const uint32_t sparseId = _sortKeys[_sortIndex++].second;
+		if (!Contains(sparseId) || _sortDenseId >= GetCount())
 			continue;
-		Bake(instance, bake);
+
+		const uint32_t denseId = GetDenseId(sparseId);
+		if (denseId != _sortDenseId)
+		{
+			Swap(_sortDenseId, denseId);
+			swaps++;
+		}
+
+		_sortDenseId++;
 	}
 }
 
-void Transform3d::System::Bake(Transform3d& transform, Baked& bake) const
+uint64_t Transform3d::System::GetMortonKey(const glm::vec3& position) const
 {
-	auto& model = bake.model;
+	constexpr int32_t bits = 21;
+	constexpr int32_t max = (1 << bits) - 1;
 
-	model = glm::mat4{ 1 };
-	model = glm::translate(model, transform.position);
+	uint64_t key = 0;
+	for (int32_t axis = 0; axis < 3; ++axis)
+	{
+		// Bias the cell so that negative positions are ordered below positive ones.
+		// Clamp before converting, since large positions don't fit in an integer. Putting zero first also maps NaN to it.
+		const float cell = std::floor(position[axis] / _sortSettings.cellSize) + static_cast<float>(1 << (bits - 1));
+		uint64_t x = static_cast<uint64_t>(std::min(std::max(0.f, cell), static_cast<float>(max)));
 
-	auto& rotation = transform.rotation;
-	const auto euler = glm::eulerAngleXYZ(
-		glm::radians(rotation.x) / 2,
-		glm::radians(rotation.y) / 2,
-		glm::radians(rotation.z) / 2);
+		// Spread the bits out, so that the axes can be interleaved.
+		x = (x | x << 32) & 0x1f00000000ffff;
+		x = (x | x << 16) & 0x1f0000ff0000ff;
+		x = (x | x << 8) & 0x100f00f00f00f00f;
+		x = (x | x << 4) & 0x10c30c30c30c30c3;
+		x = (x | x << 2) & 0x1249249249249249;
+		key |= x << axis;
+	}
 
-	model *= euler;
-	model = glm::scale(model, transform.scale);
+	return key;
 }
@@ -0,0 +1,61 @@
+﻿#include "pch.h"
+#include "UniformRing.h"
+
+void UniformRing::Construct(vi::VkRenderer& renderer, const uint32_t frameCount)
+{
+	Construct(renderer, frameCount, Settings());
+}
+
+void UniformRing::Construct(vi::VkRenderer& renderer, const uint32_t frameCount, const Settings& settings)
+{
+	_renderer = &renderer;
+	_alignment = renderer.GetPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment;
+	_size = (settings.size + _alignment - 1) / _alignment * _alignment;
+	_frameEnds.resize(frameCount);
+
+	_buffer = renderer.CreateBuffer(_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	_memory = renderer.AllocateMemory(_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	renderer.BindMemory(_buffer, _memory);
+	_data = static_cast<char*>(renderer.MapMemory(_memory));
+}
+
+void UniformRing::Cleanup()
+{
+	_renderer->DestroyBuffer(_buffer);
+	_renderer->FreeMemory(_memory);
+}
+
+void UniformRing::BeginFrame()
+{
+	_tail = _frameEnds[_frame % _frameEnds.size()];
+}
+
+void UniformRing::EndFrame()
+{
+	_frameEnds[_frame % _frameEnds.size()] = _head;
+	_frame++;
+}
+
+UniformRing::Allocation UniformRing::Allocate(const VkDeviceSize size)
+{
+	assert(size <= _size);
+
+	uint64_t position = (_head + _alignment - 1) / _alignment * _alignment;
+
+	// Allocations are contiguous, so skip the remainder of the buffer when it doesn't fit.
+	const uint64_t offset = position % _size;
+	if (offset + size > _size)
+		position += _size - offset;
+
+	// Running into the tail means that the frames in flight use more uniform data than fits in the buffer.
+	assert(position + size - _tail <= _size);
+	_head = position + size;
+
+	const auto physicalOffset = static_cast<uint32_t>(position % _size);
+	return { physicalOffset, &_data[physicalOffset] };
+}
+
+VkBuffer UniformRing::GetBuffer() const
+{
+	return _buffer;
+}
@@ -1,137 +1,87 @@
 ﻿#include "pch.h"
 #include "UnlitMaterial2d.h"
-#include "FileReader.h"
 #include "Camera2d.h"
 #include "Transform2d.h"
-#include "VkRenderer/PipelineInfo.h"
-#include "VkRenderer/DescriptorLayoutInfo.h"
-#include "VkRenderer/WindowSystemGLFW.h"
 
-UnlitMaterial2d::System::System(const uint32_t size) : ShaderSet<UnlitMaterial2d, Frame>(size)
+UnlitMaterial2d::System::System(const uint32_t size) :
+	InstancedShaderSet<UnlitMaterial2d, Frame, Vertex2d, Camera2d::System, System>(size,
+		"Shaders/vert2d.spv", "Shaders/frag2d.spv", "Shaders/frag2d_bindless.spv")
 {
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& renderer = renderSystem.GetVkRenderer();
-	auto& swapChain = renderSystem.GetSwapChain();
-
-	auto& cameraSystem = Camera2d::System::Instance::Get();
-
-	const auto vertCode = FileReader::Read("Shaders/vert2d.spv");
-	const auto fragCode = FileReader::Read("Shaders/frag2d.spv");
-
-	_vertModule = renderer.CreateShaderModule(vertCode);
-	_fragModule = renderer.CreateShaderModule(fragCode);
-
-	vi::DescriptorLayoutInfo materialLayoutInfo{};
-	vi::BindingInfo diffuseBinding{};
-	diffuseBinding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	diffuseBinding.flag = VK_SHADER_STAGE_FRAGMENT_BIT;
-	materialLayoutInfo.bindings.push_back(diffuseBinding);
-	auto layout = renderer.CreateLayout(materialLayoutInfo);
-
-	vi::PipelineLayoutInfo pipelineInfo{};
-	pipelineInfo.attributeDescriptions = Vertex2d::GetAttributeDescriptions();
-	pipelineInfo.bindingDescription = Vertex2d::GetBindingDescription();
-	pipelineInfo.setLayouts.push_back(cameraSystem.GetLayout());
-	pipelineInfo.setLayouts.push_back(layout);
-	pipelineInfo.modules.push_back(
-		{
-			_vertModule,
-			VK_SHADER_STAGE_VERTEX_BIT
-		});
-	pipelineInfo.modules.push_back(
-		{
-			_fragModule,
-			VK_SHADER_STAGE_FRAGMENT_BIT
-		});
-	pipelineInfo.pushConstants.push_back(
-		{
-			sizeof Transform2d,
-			VK_SHADER_STAGE_VERTEX_BIT
-		});
-	pipelineInfo.renderPass = swapChain.GetRenderPass();
-	pipelineInfo.extent = swapChain.GetExtent();
-
-	_pipeline = renderer.CreatePipeline(pipelineInfo);
-
-	const uint32_t imageCount = swapChain.GetImageCount();
-	VkDescriptorType uboTypes[] = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER };
-	_descriptorPool.Construct(imageCount * GetSize(), layout, uboTypes, 2);
-}
-
-void UnlitMaterial2d::System::Cleanup()
-{
-	ShaderSet<UnlitMaterial2d, Frame>::Cleanup();
-
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& renderer = renderSystem.GetVkRenderer();
-
-	renderer.DestroyPipeline(_pipeline);
-	renderer.DestroyShaderModule(_vertModule);
-	renderer.DestroyShaderModule(_fragModule);
-	_descriptorPool.Cleanup();
-}
-
-void UnlitMaterial2d::System::ConstructInstanceFrame(Frame& frame, UnlitMaterial2d&, const uint32_t)
-{
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& renderer = renderSystem.GetVkRenderer();
-
-	frame.descriptorSet = _descriptorPool.Get();
-	frame.matDiffuseSampler = renderer.CreateSampler();
-}
-
-void UnlitMaterial2d::System::CleanupInstanceFrame(Frame& frame, UnlitMaterial2d&, const uint32_t)
-{
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& renderer = renderSystem.GetVkRenderer();
-
-	_descriptorPool.Add(frame.descriptorSet);
-	renderer.DestroySampler(frame.matDiffuseSampler);
 }
 
-void UnlitMaterial2d::System::Update()
+void UnlitMaterial2d::System::FillPacket(Packet& packet)
 {
-	ShaderSet<UnlitMaterial2d, Frame>::Update();
-
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& renderer = renderSystem.GetVkRenderer();
-	auto& swapChain = renderSystem.GetSwapChain();
-
-	auto& cameraSystem = Camera2d::System::Instance::Get();
-	const auto frames = GetSets()[swapChain.GetCurrentImageIndex() + 1].Get<Frame>();
-
 	auto& transforms = Transform2d::System::Instance::Get();
+	const auto bakedTransforms = transforms.GetSets()[0].Get<Transform2d::Baked>();
 	auto& meshes = Mesh::System::Instance::Get();
-	if (cameraSystem.GetSize() == 0)
-		return;
 
-	union
-	{
-		struct
-		{
-			VkDescriptorSet cameraSet;
-			VkDescriptorSet materialSet;
-		};
-		VkDescriptorSet sets[2];
-	};
-	cameraSet = cameraSystem.GetCurrentFrameSet().Get<CameraFrame>(0).descriptor;
+	auto& cameraSystem = Camera2d::System::Instance::Get();
+	const glm::vec4 viewRect = cameraSystem.GetViewRect(cameraSystem.GetSparseId(0));
 
-	renderer.BindPipeline(_pipeline);
+	_visibleSprites.clear();
+	uint32_t batchIndex = 0;
 
 	for (const auto [instance, sparseId] : *this)
 	{
 		const uint32_t denseId = GetDenseId(sparseId);
-		auto& frame = frames[denseId];
-		auto& mesh = meshes[sparseId];
-		auto& transform = transforms[sparseId];
-		const auto& diffuseTex = *instance.diffuseTexture;
+		if (IsErased(denseId))
+			continue;
+
+		const auto& mesh = meshes[sparseId];
+		const uint32_t transformId = transforms.GetDenseId(sparseId);
+		const auto& model = bakedTransforms[transformId].model;
+
+		// Cull the world space bounds against the area that is visible to the camera.
+		const glm::vec2 localMin = mesh.boundsMin;
+		const glm::vec2 localMax = mesh.boundsMax;
+		const glm::vec2 center = model * glm::vec3((localMin + localMax) * .5f, 1);
+		const glm::vec2 extents = (localMax - localMin) * .5f;
+		const glm::vec2 rotatedExtents = glm::abs(model[0]) * extents.x + glm::abs(model[1]) * extents.y;
+
+		if (center.x + rotatedExtents.x < viewRect.x || center.y + rotatedExtents.y < viewRect.y ||
+			center.x - rotatedExtents.x > viewRect.z || center.y - rotatedExtents.y > viewRect.w)
+			continue;
+
+		// Bindless sprites never get a material, so they are only batched by mesh.
+		const auto matches = [&](const Batch& batch)
+		{
+			return batch.vertexBuffer == mesh.vertexBuffer && batch.indexBuffer == mesh.indexBuffer && batch.material == instance.material;
+		};
 
-		materialSet = frame.descriptorSet;
+		// Sprites tend to be stored next to sprites with the same texture, and there are only a few textures or atlas pages.
+		if (batchIndex >= packet.batches.size() || !matches(packet.batches[batchIndex]))
+		{
+			batchIndex = 0;
+			while (batchIndex < packet.batches.size() && !matches(packet.batches[batchIndex]))
+				batchIndex++;
+
+			if (batchIndex == packet.batches.size())
+			{
+				Batch batch{};
+				batch.vertexBuffer = mesh.vertexBuffer;
+				batch.indexBuffer = mesh.indexBuffer;
+				batch.indCount = mesh.indCount;
+				batch.descriptorSet = _bindless ? VK_NULL_HANDLE : _materialCache[instance.material].descriptorSet;
+				batch.material = instance.material;
+				packet.batches.push_back(batch);
+			}
+		}
+
+		packet.batches[batchIndex].instanceCount++;
+		_visibleSprites.push_back({ batchIndex, transformId, instance.diffuseTexture->index });
+	}
 
-		renderSystem.UseMesh(mesh);
-		renderer.BindDescriptorSets(sets, 2);
-		renderer.BindSampler(frame.descriptorSet, diffuseTex.imageView, frame.matDiffuseSampler, 0, 0);
-		renderer.UpdatePushConstant(_pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, transform);
-		renderer.Draw(mesh.indCount);
+	// Give every batch a range of the instances, and scatter the sprites into them.
+	_batchOffsets.clear();
+	uint32_t instanceCount = 0;
+	for (auto& batch : packet.batches)
+	{
+		batch.firstInstance = instanceCount;
+		_batchOffsets.push_back(instanceCount);
+		instanceCount += batch.instanceCount;
 	}
+
+	packet.instances.resize(instanceCount);
+	for (const auto& sprite : _visibleSprites)
+		packet.instances[_batchOffsets[sprite.batch]++] = { bakedTransforms[sprite.transformId].model, sprite.textureIndex };
 }
@@ -1,136 +1,133 @@
 ﻿#include "pch.h"
 #include "UnlitMaterial3d.h"
-#include "FileReader.h"
 #include "Camera3d.h"
-#include "VkRenderer/PipelineInfo.h"
 #include "Transform3d.h"
+#include "Frustum.h"
+#include "Simd.h"
 
-UnlitMaterial3d::System::System(const uint32_t size) : ShaderSet<UnlitMaterial3d, Frame>(size)
+UnlitMaterial3d::System::System(const uint32_t size) :
+	InstancedShaderSet<UnlitMaterial3d, Frame, Vertex3d, Camera3d::System, System>(size,
+		"Shaders/vert3d.spv", "Shaders/frag3d.spv", "Shaders/frag3d_bindless.spv")
 {
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& renderer = renderSystem.GetVkRenderer();
-	auto& swapChain = renderSystem.GetSwapChain();
+}
 
-	auto& cameraSystem = Camera3d::System::Instance::Get();
+void UnlitMaterial3d::System::FillPacket(Packet& packet)
+{
+	auto& transforms = Transform3d::System::Instance::Get();
+	const auto bakedTransforms = transforms.GetSets()[0].Get<Transform3d::Baked>();
+	auto& meshes = Mesh::System::Instance::Get();
 
-	const auto vertCode = FileReader::Read("Shaders/vert3d.spv");
-	const auto fragCode = FileReader::Read("Shaders/frag3d.spv");
-
-	_vertModule = renderer.CreateShaderModule(vertCode);
-	_fragModule = renderer.CreateShaderModule(fragCode);
-
-	vi::DescriptorLayoutInfo materialLayoutInfo{};
-	vi::BindingInfo diffuseBinding{};
-	diffuseBinding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	diffuseBinding.flag = VK_SHADER_STAGE_FRAGMENT_BIT;
-	materialLayoutInfo.bindings.push_back(diffuseBinding);
-	auto layout = renderer.CreateLayout(materialLayoutInfo);
-
-	vi::PipelineLayoutInfo pipelineInfo{};
-	pipelineInfo.attributeDescriptions = Vertex3d::GetAttributeDescriptions();
-	pipelineInfo.bindingDescription = Vertex3d::GetBindingDescription();
-	pipelineInfo.setLayouts.push_back(cameraSystem.GetLayout());
-	pipelineInfo.setLayouts.push_back(layout);
-	pipelineInfo.modules.push_back(
-		{
-			_vertModule,
-			VK_SHADER_STAGE_VERTEX_BIT
-		});
-	pipelineInfo.modules.push_back(
-		{
-			_fragModule,
-			VK_SHADER_STAGE_FRAGMENT_BIT
-		});
-	pipelineInfo.pushConstants.push_back(
-		{
-			sizeof Transform3d::Baked,
-			VK_SHADER_STAGE_VERTEX_BIT
-		});
-	pipelineInfo.renderPass = swapChain.GetRenderPass();
-	pipelineInfo.extent = swapChain.GetExtent();
+	auto& cameraSystem = Camera3d::System::Instance::Get();
+	Cull(cameraSystem.GetViewProjection(cameraSystem.GetSparseId(0)));
 
-	_pipeline = renderer.CreatePipeline(pipelineInfo);
+	_batchKeys.clear();
+	for (const auto& denseId : _visibleIds)
+	{
+		if (IsErased(denseId))
+			continue;
 
-	const uint32_t imageCount = swapChain.GetImageCount();
-	VkDescriptorType uboTypes[] = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER };
-	_descriptorPool.Construct(imageCount * GetSize(), layout, uboTypes, 2);
-}
+		const auto& mesh = meshes[GetSparseId(denseId)];
+		// Bindless instances never get a material, so they are only batched by mesh.
+		const auto& instance = GetValues()[denseId];
+		_batchKeys.push_back({ mesh.vertexBuffer, mesh.indexBuffer, instance.material, denseId });
+	}
 
-void UnlitMaterial3d::System::Cleanup()
-{
-	ShaderSet<UnlitMaterial3d, Frame>::Cleanup();
+	// Sorting puts the instances of a batch next to each other in the instance buffer.
+	std::sort(_batchKeys.begin(), _batchKeys.end());
 
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& renderer = renderSystem.GetVkRenderer();
+	for (uint32_t i = 0; i < _batchKeys.size(); ++i)
+	{
+		const auto& key = _batchKeys[i];
+		const uint32_t sparseId = GetSparseId(key.denseId);
+		const auto& model = bakedTransforms[transforms.GetDenseId(sparseId)].model;
+		packet.instances.push_back({ model, GetValues()[key.denseId].diffuseTexture->index });
 
-	renderer.DestroyPipeline(_pipeline);
-	renderer.DestroyShaderModule(_vertModule);
-	renderer.DestroyShaderModule(_fragModule);
-	_descriptorPool.Cleanup();
+		if (i > 0 && key.SharesBatch(_batchKeys[i - 1]))
+		{
+			packet.batches.back().instanceCount++;
+			continue;
+		}
+
+		Batch batch{};
+		batch.vertexBuffer = key.vertexBuffer;
+		batch.indexBuffer = key.indexBuffer;
+		batch.indCount = meshes[sparseId].indCount;
+		batch.descriptorSet = _bindless ? VK_NULL_HANDLE : _materialCache[key.material].descriptorSet;
+		batch.material = key.material;
+		batch.firstInstance = i;
+		batch.instanceCount = 1;
+		packet.batches.push_back(batch);
+	}
 }
 
-void UnlitMaterial3d::System::Update()
+void UnlitMaterial3d::System::Cull(const glm::mat4& viewProjection)
 {
-	ShaderSet<UnlitMaterial3d, Frame>::Update();
-
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& renderer = renderSystem.GetVkRenderer();
-	auto& swapChain = renderSystem.GetSwapChain();
-
-	auto& cameraSystem = Camera3d::System::Instance::Get();
-	auto& frames = GetSets()[swapChain.GetCurrentImageIndex() + 1];
-
 	auto& transforms = Transform3d::System::Instance::Get();
 	const auto bakedTransforms = transforms.GetSets()[0].Get<Transform3d::Baked>();
 	auto& meshes = Mesh::System::Instance::Get();
-	if (cameraSystem.GetSize() == 0)
-		return;
 
-	union
+	constexpr uint32_t width = simd::Float::width;
+	const uint32_t count = GetCount();
+	const uint32_t batchCount = (count + width - 1) / width;
+
+	// Gather the world space bounding spheres in SoA batches.
+	_cullSpheres.resize(batchCount * width * 4);
+	for (uint32_t denseId = 0; denseId < batchCount * width; ++denseId)
 	{
-		struct
+		float* batch = &_cullSpheres[denseId / width * width * 4];
+		const uint32_t lane = denseId % width;
+
+		// Padding never passes the test.
+		glm::vec4 sphere{ 0, 0, 0, -FLT_MAX };
+		if (denseId < count)
 		{
-			VkDescriptorSet cameraSet;
-			VkDescriptorSet materialSet;
-		};
-		VkDescriptorSet sets[2];
-	};
-	cameraSet = cameraSystem.GetCurrentFrameSet().Get<CameraFrame>(0).descriptor;
+			const uint32_t sparseId = GetSparseId(denseId);
+			const auto& mesh = meshes[sparseId];
+			const auto& model = bakedTransforms[transforms.GetDenseId(sparseId)].model;
 
-	renderer.BindPipeline(_pipeline);
+			const float scale = std::max(std::max(glm::dot(model[0], model[0]), glm::dot(model[1], model[1])), glm::dot(model[2], model[2]));
+			sphere = glm::vec4(glm::vec3(model * glm::vec4((mesh.boundsMin + mesh.boundsMax) * .5f, 1)), mesh.boundsRadius * std::sqrt(scale));
+		}
 
-	for (const auto [instance, sparseId] : *this)
+		for (uint32_t i = 0; i < 4; ++i)
+			batch[i * width + lane] = sphere[i];
+	}
+
+	const auto frustum = Frustum::FromMatrix(viewProjection);
+	const auto zero = simd::Float::Splat(0);
+	_visibleIds.clear();
+
+	// An instance is culled when its sphere is fully behind any of the planes.
+	for (uint32_t i = 0; i < batchCount; ++i)
 	{
-		const uint32_t denseId = GetDenseId(sparseId);
-		auto& frame = frames.Get<Frame>(denseId);
-		auto& mesh = meshes[sparseId];
-		auto& bakedTransform = bakedTransforms[transforms.GetDenseId(sparseId)];
-		const auto& diffuseTex = *instance.diffuseTexture;
-
-		materialSet = frame.descriptorSet;
-
-		renderSystem.UseMesh(mesh);
-		renderer.BindDescriptorSets(sets, 2);
-		renderer.BindSampler(frame.descriptorSet, diffuseTex.imageView, frame.matDiffuseSampler, 0, 0);
-		renderer.UpdatePushConstant(_pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, bakedTransform);
-		renderer.Draw(mesh.indCount);
+		const float* batch = &_cullSpheres[i * width * 4];
+		const auto x = simd::Float::Load(&batch[0]);
+		const auto y = simd::Float::Load(&batch[width]);
+		const auto z = simd::Float::Load(&batch[width * 2]);
+		const auto negativeRadius = zero - simd::Float::Load(&batch[width * 3]);
+
+		uint32_t culled = 0;
+		for (const auto& plane : frustum.planes)
+		{
+			const auto distance = simd::Float::Splat(plane.x) * x + simd::Float::Splat(plane.y) * y +
+				simd::Float::Splat(plane.z) * z + simd::Float::Splat(plane.w);
+			culled |= simd::LessThan(distance, negativeRadius);
+		}
+
+		for (uint32_t lane = 0; lane < width; ++lane)
+			if (!(culled & 1 << lane))
+				_visibleIds.push_back(i * width + lane);
 	}
 }
 
-void UnlitMaterial3d::System::ConstructInstanceFrame(Frame& frame, UnlitMaterial3d&, const uint32_t)
+bool UnlitMaterial3d::System::BatchKey::SharesBatch(const BatchKey& other) const
 {
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& renderer = renderSystem.GetVkRenderer();
-
-	frame.descriptorSet = _descriptorPool.Get();
-	frame.matDiffuseSampler = renderer.CreateSampler();
+	return vertexBuffer == other.vertexBuffer && indexBuffer == other.indexBuffer && material == other.material;
 }
 
-void UnlitMaterial3d::System::CleanupInstanceFrame(Frame& frame, UnlitMaterial3d&, const uint32_t)
+bool UnlitMaterial3d::System::BatchKey::operator<(const BatchKey& other) const
 {
-	auto& renderSystem = RenderSystem::Instance::Get();
-	auto& renderer = renderSystem.GetVkRenderer();
-
-	_descriptorPool.Add(frame.descriptorSet);
-	renderer.DestroySampler(frame.matDiffuseSampler);
-}
+	// Breaking ties by dense id keeps the order of the instances within a batch the same across frames.
+	return std::tie(vertexBuffer, indexBuffer, material, denseId) <
+		std::tie(other.vertexBuffer, other.indexBuffer, other.material, other.denseId);
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+﻿#include "pch.h"
+#include "UpdateLod.h"
+
+UpdateLod::UpdateLod(const uint32_t size) : UpdateLod(size, Settings())
+{
+}
+
+UpdateLod::UpdateLod(const uint32_t size, const Settings& settings) : _settings(settings)
+{
+	assert(settings.bucketCount > 0 && settings.bucketCount <= 32);
+	assert(settings.distance > 0);
+
+	_locations.resize(size);
+	_buckets.resize(settings.bucketCount);
+	_periodMembers.resize(settings.bucketCount);
+}
+
+void UpdateLod::Insert(const uint32_t sparseId, const uint32_t bucket)
+{
+	assert(!Contains(sparseId));
+	Append(sparseId, bucket);
+	_locations[sparseId].lastFrame = _frame;
+}
+
+void UpdateLod::Erase(const uint32_t sparseId)
+{
+	if (Contains(sparseId))
+		Remove(sparseId);
+}
+
+void UpdateLod::Assign(const uint32_t sparseId, uint32_t bucket)
+{
+	assert(Contains(sparseId));
+	bucket = std::min(bucket, _settings.bucketCount - 1);
+	if (_locations[sparseId].bucket == static_cast<int32_t>(bucket))
+		return;
+
+	Remove(sparseId);
+	Append(sparseId, bucket);
+}
+
+void UpdateLod::AssignByDistance(const uint32_t sparseId, const float distance)
+{
+	const float ratio = distance / _settings.distance;
+	const uint32_t bucket = ratio < 1 ? 0 : static_cast<uint32_t>(std::min(std::log2(ratio), 31.f)) + 1;
+	Assign(sparseId, bucket);
+}
+
+void UpdateLod::AssignByPriority(const uint32_t sparseId, const float priority)
+{
+	const uint32_t bucket = priority >= 1 ? 0 : priority <= 0 ? _settings.bucketCount - 1 :
+		static_cast<uint32_t>(std::min(-std::log2(priority), 31.f));
+	Assign(sparseId, bucket);
+}
+
+bool UpdateLod::Contains(const uint32_t sparseId) const
+{
+	return _locations[sparseId].bucket != -1;
+}
+
+uint32_t UpdateLod::GetBucket(const uint32_t sparseId) const
+{
+	assert(Contains(sparseId));
+	return _locations[sparseId].bucket;
+}
+
+uint32_t UpdateLod::GetBucketCount() const
+{
+	return _settings.bucketCount;
+}
+
+uint32_t UpdateLod::GetDueCount() const
+{
+	return _dueCount;
+}
+
+void UpdateLod::Remove(const uint32_t sparseId)
+{
+	auto& location = _locations[sparseId];
+	auto& bucket = _buckets[location.bucket];
+
+	const uint32_t movedId = bucket.back();
+	bucket[location.index] = movedId;
+	_locations[movedId].index = location.index;
+	bucket.pop_back();
+
+	location.bucket = -1;
+}
+
+void UpdateLod::Append(const uint32_t sparseId, const uint32_t bucket)
+{
+	auto& location = _locations[sparseId];
+	location.bucket = static_cast<int32_t>(std::min(bucket, _settings.bucketCount - 1));
+	location.index = static_cast<uint32_t>(_buckets[location.bucket].size());
+	_buckets[location.bucket].push_back(sparseId);
+}
@@ -0,0 +1,227 @@
+﻿#include "pch.h"
+#include "UploadManager.h"
+
+void UploadManager::Construct(vi::VkRenderer& renderer, const uint32_t frameCount)
+{
+	Construct(renderer, frameCount, Settings());
+}
+
+void UploadManager::Construct(vi::VkRenderer& renderer, const uint32_t frameCount, const Settings& settings)
+{
+	_renderer = &renderer;
+	// Image copies have to start at a multiple of the texel size.
+	_alignment = std::max<VkDeviceSize>(renderer.GetPhysicalDeviceProperties().limits.optimalBufferCopyOffsetAlignment, 4);
+	_size = (settings.stagingSize + _alignment - 1) / _alignment * _alignment;
+	_frames.resize(frameCount);
+
+	_transferQueue = renderer.HasTransferQueue();
+	if (_transferQueue)
+		for (auto& frame : _frames)
+		{
+			frame.commandBuffer = renderer.CreateCommandBuffer(true);
+			frame.semaphore = renderer.CreateSemaphore();
+		}
+
+	_buffer = renderer.CreateBuffer(_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	_memory = renderer.AllocateMemory(_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	renderer.BindMemory(_buffer, _memory);
+	_data = static_cast<char*>(renderer.MapMemory(_memory));
+}
+
+void UploadManager::Cleanup()
+{
+	// Uploads that were never recorded are dropped.
+	for (auto& frame : _frames)
+	{
+		for (const auto& stagingBuffer : frame.stagingBuffers)
+			DestroyStagingBuffer(stagingBuffer);
+
+		if (!_transferQueue)
+			continue;
+		_renderer->DestroyCommandBuffer(frame.commandBuffer, true);
+		_renderer->DestroySemaphore(frame.semaphore);
+	}
+	for (const auto& stagingBuffer : _stagingBuffers)
+		DestroyStagingBuffer(stagingBuffer);
+
+	_renderer->DestroyBuffer(_buffer);
+	_renderer->FreeMemory(_memory);
+}
+
+void UploadManager::BeginFrame()
+{
+	auto& frame = _frames[_frame % _frames.size()];
+	for (const auto& stagingBuffer : frame.stagingBuffers)
+		DestroyStagingBuffer(stagingBuffer);
+	frame.stagingBuffers.clear();
+
+	// Frames finish in order, so everything up to the oldest frame is done.
+	// The frame waited on its transfer submission, so the command buffer and semaphore are free as well.
+	_completedTicket = frame.ticket;
+
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		_tail = frame.end;
+
+		_recording.clear();
+		std::swap(_recording, _requests);
+		frame.end = _head;
+		frame.ticket = _ticket;
+		frame.stagingBuffers.insert(frame.stagingBuffers.end(), _stagingBuffers.begin(), _stagingBuffers.end());
+		_stagingBuffers.clear();
+	}
+
+	_semaphore = VK_NULL_HANDLE;
+	if (!_transferQueue || _recording.empty())
+		return;
+
+	_renderer->BeginCommandBufferRecording(frame.commandBuffer);
+	RecordCopies();
+
+	// Releasing the images also moves them to the layout they are sampled in.
+	for (const auto& request : _recording)
+	{
+		if (request.dstImage)
+			_renderer->ReleaseOwnership(request.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		else
+			_renderer->ReleaseOwnership(request.dstBuffer);
+	}
+
+	_renderer->EndCommandBufferRecording();
+	_renderer->SubmitTransfer(&frame.commandBuffer, 1, frame.semaphore);
+	_semaphore = frame.semaphore;
+}
+
+void UploadManager::Record()
+{
+	_frame++;
+
+	if (_transferQueue)
+	{
+		for (const auto& request : _recording)
+		{
+			if (request.dstImage)
+				_renderer->AcquireOwnership(request.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+			else
+				_renderer->AcquireOwnership(request.dstBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 
+					VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+		}
+
+		return;
+	}
+
+	RecordCopies();
+
+	bool buffers = false;
+	for (const auto& request : _recording)
+	{
+		if (request.dstImage)
+			_renderer->TransitionImageLayout(request.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		else
+			buffers = true;
+	}
+
+	if (buffers)
+		_renderer->PipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+}
+
+VkSemaphore UploadManager::GetSemaphore() const
+{
+	return _semaphore;
+}
+
+uint64_t UploadManager::Upload(const VkBuffer dstBuffer, const void* data, const VkDeviceSize size)
+{
+	Request request{};
+	request.dstBuffer = dstBuffer;
+	request.size = size;
+	return Enqueue(request, data);
+}
+
+uint64_t UploadManager::Upload(const VkImage dstImage, const glm::ivec2 resolution, const void* data, const VkDeviceSize size)
+{
+	Request request{};
+	request.dstImage = dstImage;
+	request.resolution = resolution;
+	request.size = size;
+	return Enqueue(request, data);
+}
+
+bool UploadManager::IsReady(const uint64_t ticket) const
+{
+	return ticket <= _completedTicket;
+}
+
+void UploadManager::RecordCopies() const
+{
+	for (const auto& request : _recording)
+		if (request.dstImage)
+			_renderer->TransitionImageLayout(request.dstImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	for (const auto& request : _recording)
+	{
+		if (request.dstImage)
+			_renderer->CopyBuffer(request.srcBuffer, request.dstImage, request.resolution.x, request.resolution.y, request.srcOffset);
+		else
+			_renderer->CopyBuffer(request.srcBuffer, request.dstBuffer, request.size, request.srcOffset);
+	}
+}
+
+uint64_t UploadManager::Enqueue(Request& request, const void* data)
+{
+	{
+		// The data is copied while holding the lock, so that the frame that reclaims the space always recorded it.
+		std::lock_guard<std::mutex> guard(_mutex);
+		if (TryAllocate(request.size, request.srcOffset))
+		{
+			memcpy(&_data[request.srcOffset], data, request.size);
+			request.srcBuffer = _buffer;
+			_requests.push_back(request);
+			return ++_ticket;
+		}
+	}
+
+	// Running out of ring space doesn't block, since the render thread might not be running yet.
+	StagingBuffer stagingBuffer{};
+	stagingBuffer.buffer = _renderer->CreateBuffer(request.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	stagingBuffer.memory = _renderer->AllocateMemory(stagingBuffer.buffer, 
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	_renderer->BindMemory(stagingBuffer.buffer, stagingBuffer.memory);
+	memcpy(_renderer->MapMemory(stagingBuffer.memory), data, request.size);
+
+	request.srcBuffer = stagingBuffer.buffer;
+	request.srcOffset = 0;
+
+	std::lock_guard<std::mutex> guard(_mutex);
+	_stagingBuffers.push_back(stagingBuffer);
+	_requests.push_back(request);
+	return ++_ticket;
+}
+
+bool UploadManager::TryAllocate(const VkDeviceSize size, VkDeviceSize& outOffset)
+{
+	if (size > _size)
+		return false;
+
+	uint64_t position = (_head + _alignment - 1) / _alignment * _alignment;
+
+	// Allocations are contiguous, so skip the remainder of the buffer when it doesn't fit.
+	const uint64_t offset = position % _size;
+	if (offset + size > _size)
+		position += _size - offset;
+
+	if (position + size - _tail > _size)
+		return false;
+
+	_head = position + size;
+	outOffset = position % _size;
+	return true;
+}
+
+void UploadManager::DestroyStagingBuffer(const StagingBuffer& stagingBuffer)
+{
+	_renderer->DestroyBuffer(stagingBuffer.buffer);
+	_renderer->FreeMemory(stagingBuffer.memory);
+}
\ No newline at end of file
@@ -30,3 +30,37 @@ std::vector<VkVertexInputAttributeDescription> Vertex2d::GetAttributeDescription
 
 	return attributeDescriptions;
 }
+
+VkVertexInputBindingDescription Vertex2d::GetInstanceBindingDescription()
+{
+	VkVertexInputBindingDescription bindingDescription{};
+	bindingDescription.binding = 1;
+	bindingDescription.stride = sizeof(Instance);
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	return bindingDescription;
+}
+
+std::vector<VkVertexInputAttributeDescription> Vertex2d::GetInstanceAttributeDescriptions()
+{
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+	attributeDescriptions.resize(4);
+
+	// A matrix takes up a location per column.
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		auto& column = attributeDescriptions[i];
+		column.binding = 1;
+		column.location = 2 + i;
+		column.format = VK_FORMAT_R32G32_SFLOAT;
+		column.offset = offsetof(Instance, model) + sizeof(glm::vec2) * i;
+	}
+
+	auto& textureIndex = attributeDescriptions[3];
+	textureIndex.binding = 1;
+	textureIndex.location = 5;
+	textureIndex.format = VK_FORMAT_R32_UINT;
+	textureIndex.offset = offsetof(Instance, textureIndex);
+
+	return attributeDescriptions;
+}
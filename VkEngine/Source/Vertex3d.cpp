@@ -36,3 +36,37 @@ std::vector<VkVertexInputAttributeDescription> Vertex3d::GetAttributeDescription
 
 	return attributeDescriptions;
 }
+
+VkVertexInputBindingDescription Vertex3d::GetInstanceBindingDescription()
+{
+	VkVertexInputBindingDescription bindingDescription{};
+	bindingDescription.binding = 1;
+	bindingDescription.stride = sizeof(Instance);
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	return bindingDescription;
+}
+
+std::vector<VkVertexInputAttributeDescription> Vertex3d::GetInstanceAttributeDescriptions()
+{
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+	attributeDescriptions.resize(5);
+
+	// A matrix takes up a location per column.
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		auto& column = attributeDescriptions[i];
+		column.binding = 1;
+		column.location = 3 + i;
+		column.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		column.offset = offsetof(Instance, model) + sizeof(glm::vec4) * i;
+	}
+
+	auto& textureIndex = attributeDescriptions[4];
+	textureIndex.binding = 1;
+	textureIndex.location = 7;
+	textureIndex.format = VK_FORMAT_R32_UINT;
+	textureIndex.offset = offsetof(Instance, textureIndex);
+
+	return attributeDescriptions;
+}
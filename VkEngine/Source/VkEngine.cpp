@@ -5,6 +5,7 @@
 #include "Vertex2d.h"
 #include "Mesh.h"
 #include "RenderSystem.h"
+#include "RenderThread.h"
 #include "Singleton.h"
 #include "Transform2d.h"
 #include "Camera2d.h"
@@ -12,6 +13,11 @@
 #include "UnlitMaterial3d.h"
 #include "Transform3d.h"
 #include "Camera3d.h"
+#include "AabbTree.h"
+#include "SpatialHash2d.h"
+#include "FrameDriver.h"
+#include "UpdateLod.h"
+#include "BudgetScheduler.h"
 
 int main()
 {
@@ -21,6 +27,12 @@ int main()
 	RenderSystem renderSystem{};
 	RenderSystem::Instance::Set(&renderSystem);
 
+	RenderThread renderThread{};
+	RenderThread::Instance::Set(&renderThread);
+
+	BudgetScheduler budgetScheduler{};
+	BudgetScheduler::Instance::Set(&budgetScheduler);
+
 	auto& renderer = renderSystem.GetVkRenderer();
 
 	const auto transform2dSystem = new Transform2d::System(entityCount);
@@ -51,6 +63,18 @@ int main()
 	UnlitMaterial3d::System::Instance::Set(unlitMaterial3dSystem);
 	cecsar.AddSet(unlitMaterial3dSystem);
 
+	AabbTree aabbTree{ entityCount };
+	AabbTree::Instance::Set(&aabbTree);
+
+	SpatialHash2d spatialHash2d{ entityCount };
+	SpatialHash2d::Instance::Set(&spatialHash2d);
+
+	FrameDriver frameDriver{};
+	FrameDriver::Instance::Set(&frameDriver);
+
+	UpdateLod spinLod{ entityCount };
+	cecsar.AddSet(&spinLod);
+
 	// Create scene instances.
 	auto texture = renderSystem.CreateTexture("Example.jpg");
 
@@ -109,33 +133,62 @@ int main()
 	const auto cube3Entity = cecsar.AddEntity();
 	auto& cube3Transform = transform3dSystem->Insert(cube3Entity.index);
 	cube3Transform.position = { 0, 0, 0 };
-	cube3Transform.rotation = { 45, 38, 12 };
+	cube3Transform.SetEulerRotation({ 45, 38, 12 });
 	auto& cube3Mesh = meshSystem->Insert(cube3Entity.index);
 	cube3Mesh = cubeMesh;
 	auto& unlitMaterial3d3 = unlitMaterial3dSystem->Insert(cube3Entity.index);
 	unlitMaterial3d3.diffuseTexture = &texture;
 
+	spinLod.Insert(cube2Entity.index);
+	spinLod.Insert(cube3Entity.index);
+
 	while(true)
 	{
 		bool quit;
-		renderSystem.BeginFrame(&quit);
+		renderSystem.PollEvents(&quit);
 		if (quit)
 			break;
 
-		static float f = 0;
-		f += .001f;
-		cam3dTransform.position = { std::sin(f) * 20, -5, std::cos(f) * 20};
-
-		transform3dSystem->Update();
+		// Simulate at a fixed rate, and interpolate between the last two ticks when baking.
+		frameDriver.BeginFrame();
+		while (frameDriver.Tick())
+		{
+			transform2dSystem->StorePrevious();
+			transform3dSystem->StorePrevious();
+
+			static float f = 0;
+			f += .06f * frameDriver.GetTickDelta();
+			cam3dTransform.position = { std::sin(f) * 20, -5, std::cos(f) * 20};
+
+			// Cubes further away from the camera are spun less often, but by the same amount over time.
+			spinLod.Update([&](const uint32_t sparseId, const uint32_t ticks)
+			{
+				auto& transform = (*transform3dSystem)[sparseId];
+				const float angle = static_cast<float>(ticks) * frameDriver.GetTickDelta();
+				transform.rotation = glm::angleAxis(angle, glm::vec3(0, 1, 0)) * transform.rotation;
+				spinLod.AssignByDistance(sparseId, glm::distance(transform.position, cam3dTransform.position));
+			});
+		}
+
+		const float alpha = frameDriver.GetAlpha();
+		transform2dSystem->Update(alpha);
+		spatialHash2d.Update();
+		transform3dSystem->Update(alpha);
+		aabbTree.Update();
 		camera2dSystem->Update();
 		camera3dSystem->Update();
 
 		unlitMaterial2dSystem->Update();
 		unlitMaterial3dSystem->Update();
 
-		renderSystem.EndFrame();
+		// Deferred work, like cleaning up erased instances, is spread over frames instead of landing in one.
+		budgetScheduler.Run();
+
+		// The render thread records this frame while the next one is simulated.
+		renderThread.Submit();
 	}
 
+	renderThread.Flush();
 	renderer.DeviceWaitIdle();
 
 	renderSystem.DestroyMesh(quadMesh);
@@ -0,0 +1,95 @@
+﻿#include "pch.h"
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(const uint32_t threadCount)
+{
+	for (uint32_t i = 1; i < std::max(threadCount, 1u); ++i)
+		_threads.emplace_back(&WorkerPool::Run, this, i);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+
+	_condition.notify_all();
+	for (auto& thread : _threads)
+		thread.join();
+}
+
+void WorkerPool::ParallelFor(const uint32_t count, const Job& job)
+{
+	const uint32_t threadCount = GetThreadCount();
+	const uint32_t chunkSize = (count + threadCount - 1) / threadCount;
+
+	if (_threads.empty())
+	{
+		job(0, count, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_job = &job;
+		_count = count;
+		_chunkSize = chunkSize;
+		_remaining = static_cast<uint32_t>(_threads.size());
+		_generation++;
+	}
+
+	_condition.notify_all();
+
+	// The calling thread handles the first chunk.
+	job(0, std::min(count, chunkSize), 0);
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_doneCondition.wait(lock, [this]
+	{
+		return _remaining == 0;
+	});
+}
+
+uint32_t WorkerPool::GetThreadCount() const
+{
+	return static_cast<uint32_t>(_threads.size()) + 1;
+}
+
+void WorkerPool::Run(const uint32_t thread)
+{
+	uint64_t generation = 0;
+
+	while (true)
+	{
+		const Job* job;
+		uint32_t begin;
+		uint32_t end;
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this, generation]
+			{
+				return _quit || _generation != generation;
+			});
+
+			if (_quit)
+				return;
+			generation = _generation;
+			job = _job;
+			begin = std::min(_count, thread * _chunkSize);
+			end = std::min(_count, (thread + 1) * _chunkSize);
+		}
+
+		(*job)(begin, end, thread);
+
+		bool done;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			done = --_remaining == 0;
+		}
+
+		if (done)
+			_doneCondition.notify_one();
+	}
+}
\ No newline at end of file
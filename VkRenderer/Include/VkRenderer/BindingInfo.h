@@ -8,5 +8,6 @@ namespace vi
 		size_t size = sizeof(int32_t);
 		uint32_t count = 1;
 		VkShaderStageFlagBits flag;
+		VkDescriptorBindingFlagsEXT bindingFlags = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,69 @@
+﻿#pragma once
+#include <mutex>
+#include <unordered_set>
+
+namespace vi
+{
+	class VkRenderer;
+
+	struct Allocation final
+	{
+		static constexpr uint32_t dedicated = UINT32_MAX;
+
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		// Host visible memory stays mapped for as long as it exists.
+		void* data = nullptr;
+		uint32_t block = dedicated;
+		uint32_t order = 0;
+	};
+
+	// Places resources in large blocks of device memory, since drivers limit the number of allocations and allocating is slow.
+	// Blocks are split with a buddy allocator. Buffers and images never share a block, and images are rounded up to the
+	// buffer image granularity, so linear and optimal resources never end up on the same page.
+	class MemoryAllocator final
+	{
+	public:
+		struct Settings final
+		{
+			// Has to be the minimum allocation size times a power of two.
+			VkDeviceSize blockSize = 64 << 20;
+			VkDeviceSize minAllocationSize = 256;
+			// Resources that are larger than this get their own device memory.
+			VkDeviceSize dedicatedSize = 16 << 20;
+		};
+
+		void Construct(VkRenderer& renderer);
+		void Construct(VkRenderer& renderer, const Settings& settings);
+		// Empty blocks are kept around until now, so that short lived staging buffers don't allocate device memory each time.
+		void Cleanup();
+
+		[[nodiscard]] Allocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags flags, bool image);
+		void Free(const Allocation& allocation);
+
+		// The number of device memory allocations, which is what drivers limit.
+		[[nodiscard]] uint32_t GetDeviceAllocationCount() const;
+
+	private:
+		struct Block final
+		{
+			VkDeviceMemory memory;
+			void* data;
+			uint32_t memoryTypeIndex;
+			bool image;
+			// The offsets of the free ranges, per order.
+			std::vector<std::unordered_set<VkDeviceSize>> freeRanges;
+		};
+
+		VkRenderer* _renderer = nullptr;
+		Settings _settings;
+		uint32_t _orderCount = 0;
+		std::vector<Block> _blocks{};
+		uint32_t _dedicatedCount = 0;
+		// Allocations are made on both the main and the render thread.
+		mutable std::mutex _mutex{};
+
+		[[nodiscard]] VkDeviceMemory AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** data) const;
+		[[nodiscard]] bool AllocateFromBlock(Block& block, uint32_t order, VkDeviceSize& offset) const;
+	};
+}
\ No newline at end of file
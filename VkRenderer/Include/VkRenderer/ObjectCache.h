@@ -0,0 +1,127 @@
+﻿#pragma once
+#include <mutex>
+#include <unordered_map>
+
+namespace vi
+{
+	// Hands out the same object for create infos that have been seen before, and keeps track of how many users it has.
+	// Keys are the relevant fields of a create info, so equal objects also share their handle, which makes it usable as a sort key.
+	// Every call locks the cache, so that samplers, layouts and pipelines can be created and destroyed from any thread.
+	template <typename Handle>
+	class ObjectCache final
+	{
+	public:
+		typedef std::vector<uint64_t> Key;
+
+		// Returns the object for the key and adds a user to it, and only calls create when there is none yet.
+		// Creating happens under the lock, so that two threads can't both create an object for the same key.
+		template <typename Create>
+		[[nodiscard]] Handle Acquire(const Key& key, Create&& create);
+		// Returns true when the last user is gone, after which the object has to be destroyed.
+		[[nodiscard]] bool Release(Handle handle);
+
+		// Calls the function for every object that is still in use, and empties the cache.
+		template <typename Func>
+		void Clear(Func&& func);
+
+		[[nodiscard]] uint32_t GetCount() const;
+		// The key of an object that is still in use.
+		[[nodiscard]] Key GetKey(Handle handle) const;
+
+	private:
+		struct KeyHash final
+		{
+			[[nodiscard]] size_t operator()(const Key& key) const;
+		};
+
+		struct Entry final
+		{
+			Handle handle;
+			uint32_t refCount;
+		};
+
+		std::unordered_map<Key, Entry, KeyHash> _entries{};
+		std::unordered_map<Handle, Key> _keys{};
+		mutable std::mutex _mutex{};
+	};
+
+	template <typename Handle>
+	template <typename Create>
+	Handle ObjectCache<Handle>::Acquire(const Key& key, Create&& create)
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+
+		const auto found = _entries.find(key);
+		if (found != _entries.end())
+		{
+			found->second.refCount++;
+			return found->second.handle;
+		}
+
+		const Handle handle = create();
+		_entries.emplace(key, Entry{ handle, 1 });
+		_keys.emplace(handle, key);
+		return handle;
+	}
+
+	template <typename Handle>
+	bool ObjectCache<Handle>::Release(const Handle handle)
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+
+		const auto key = _keys.find(handle);
+		assert(key != _keys.end());
+
+		auto& entry = _entries.find(key->second)->second;
+		assert(entry.refCount > 0);
+		if (--entry.refCount > 0)
+			return false;
+
+		_entries.erase(key->second);
+		_keys.erase(key);
+		return true;
+	}
+
+	template <typename Handle>
+	template <typename Func>
+	void ObjectCache<Handle>::Clear(Func&& func)
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+
+		for (const auto& [key, entry] : _entries)
+			func(entry.handle);
+
+		_entries.clear();
+		_keys.clear();
+	}
+
+	template <typename Handle>
+	uint32_t ObjectCache<Handle>::GetCount() const
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		return static_cast<uint32_t>(_entries.size());
+	}
+
+	template <typename Handle>
+	typename ObjectCache<Handle>::Key ObjectCache<Handle>::GetKey(const Handle handle) const
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+
+		const auto key = _keys.find(handle);
+		assert(key != _keys.end());
+		return key->second;
+	}
+
+	template <typename Handle>
+	size_t ObjectCache<Handle>::KeyHash::operator()(const Key& key) const
+	{
+		// FNV-1a over the fields.
+		uint64_t hash = 14695981039346656037ull;
+		for (const uint64_t field : key)
+		{
+			hash ^= field;
+			hash *= 1099511628211ull;
+		}
+		return static_cast<size_t>(hash);
+	}
+}
\ No newline at end of file
@@ -22,10 +22,12 @@ namespace vi
 				{
 					uint32_t graphics;
 					uint32_t present;
+					uint32_t transfer;
 				};
 
-				uint32_t values[2]
+				uint32_t values[3]
 				{
+					UINT32_MAX,
 					UINT32_MAX,
 					UINT32_MAX
 				};
@@ -16,7 +16,8 @@ namespace vi
 			VkShaderStageFlags flag;
 		};
 
-		VkVertexInputBindingDescription bindingDescription;
+		// Vertex data and, when instanced, per instance data are read from separate bindings.
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
 		std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
 		std::vector<Module> modules{};
 
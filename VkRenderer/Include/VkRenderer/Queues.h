@@ -8,11 +8,12 @@ namespace vi
 		{
 			struct
 			{
-				// Todo transfer buffer.
 				VkQueue graphics;
 				VkQueue present;
+				// Same as the graphics queue when there is no dedicated transfer queue family.
+				VkQueue transfer;
 			};
-			VkQueue values[2];
+			VkQueue values[3];
 		};
 	};
 }
\ No newline at end of file
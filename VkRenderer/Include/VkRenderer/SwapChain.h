@@ -1,4 +1,5 @@
 ﻿#pragma once
+#include "MemoryAllocator.h"
 
 namespace vi
 {
@@ -31,7 +32,7 @@ namespace vi
 
 			VkImage image;
 			VkImage depthImage;
-			VkDeviceMemory depthImageMemory;
+			Allocation depthImageMemory;
 
 			VkFramebuffer frameBuffer;
 			VkCommandBuffer commandBuffer;
@@ -3,6 +3,8 @@
 #include "PhysicalDeviceFactory.h"
 #include "Queues.h"
 #include "Pipeline.h"
+#include "ObjectCache.h"
+#include "MemoryAllocator.h"
 
 namespace vi
 {
@@ -16,6 +18,7 @@ namespace vi
 	{
 		friend Debugger;
 		friend SwapChain;
+		friend MemoryAllocator;
 
 		friend CommandPoolFactory;
 		friend InstanceFactory;
@@ -27,11 +30,15 @@ namespace vi
 		{
 			PhysicalDeviceFactory::Settings physicalDevice{};
 			Debugger::Settings debugger{};
+			MemoryAllocator::Settings memory{};
 
 			std::vector<const char*> deviceExtensions =
 			{
 				VK_KHR_SWAPCHAIN_EXTENSION_NAME
 			};
+
+			// Enables runtime sized, partially bound and update after bind descriptor arrays.
+			bool descriptorIndexing = false;
 		};
 
 		void Construct(class WindowSystem& system, const Settings& settings = {});
@@ -43,21 +50,29 @@ namespace vi
 		[[nodiscard]] VkRenderPass CreateRenderPass(const struct RenderPassInfo& info) const;
 		void DestroyRenderPass(VkRenderPass renderPass) const;
 
-		[[nodiscard]] VkDescriptorSetLayout CreateLayout(const struct DescriptorLayoutInfo& info) const;
-		void DestroyLayout(VkDescriptorSetLayout layout) const;
+		// Identical layouts share their handle, and are destroyed once every creator has destroyed them.
+		[[nodiscard]] VkDescriptorSetLayout CreateLayout(const struct DescriptorLayoutInfo& info);
+		void DestroyLayout(VkDescriptorSetLayout layout);
 
-		[[nodiscard]] VkDescriptorPool CreateDescriptorPool(VkDescriptorType* types, uint32_t typeCount, uint32_t maxSets) const;
+		[[nodiscard]] VkDescriptorPool CreateDescriptorPool(VkDescriptorType* types, uint32_t typeCount, uint32_t maxSets,
+			uint32_t descriptorsPerSet = 1, VkDescriptorPoolCreateFlags flags = 0) const;
 		void CreateDescriptorSets(VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet* outSets, uint32_t setCount) const;
 		void BindBuffer(VkDescriptorSet set, VkBuffer buffer, const struct BindingInfo& info, uint32_t bindingIndex, uint32_t arrayIndex) const;
 		void BindSampler(VkDescriptorSet set, VkImageView imageView, VkSampler sampler, 
 			uint32_t bindingIndex, uint32_t arrayIndex) const;
+		// Writes the samplers of multiple sets in a single update.
+		void BindSamplers(const VkDescriptorSet* sets, const VkImageView* imageViews, const VkSampler* samplers, uint32_t count,
+			uint32_t bindingIndex, uint32_t arrayIndex) const;
 		void DestroyDescriptorPool(VkDescriptorPool pool) const;
 
-		[[nodiscard]] Pipeline CreatePipeline(const struct PipelineLayoutInfo& info) const;
-		void DestroyPipeline(Pipeline pipeline) const;
+		// Only the pipeline layout is shared between pipelines, like the descriptor set layouts.
+		// The set layouts have to be created with CreateLayout, since the pipeline layouts are looked up by their bindings.
+		[[nodiscard]] Pipeline CreatePipeline(const struct PipelineLayoutInfo& info);
+		void DestroyPipeline(Pipeline pipeline);
 
-		[[nodiscard]] VkCommandBuffer CreateCommandBuffer() const;
-		void DestroyCommandBuffer(VkCommandBuffer commandBuffer) const;
+		// Transfer command buffers can only be submitted to the transfer queue.
+		[[nodiscard]] VkCommandBuffer CreateCommandBuffer(bool transfer = false) const;
+		void DestroyCommandBuffer(VkCommandBuffer commandBuffer, bool transfer = false) const;
 
 		[[nodiscard]] VkImage CreateImage(glm::ivec2 resolution, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL,
 			VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT) const;
@@ -67,8 +82,9 @@ namespace vi
 			VkImageAspectFlags aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT) const;
 		void DestroyImageView(VkImageView imageView) const;
 
-		[[nodiscard]] VkSampler CreateSampler(VkFilter magFilter = VK_FILTER_LINEAR, VkFilter minFilter = VK_FILTER_LINEAR) const;
-		void DestroySampler(VkSampler sampler) const;
+		// Samplers are shared like the descriptor set layouts, which keeps them well below the sampler allocation limit.
+		[[nodiscard]] VkSampler CreateSampler(VkFilter magFilter = VK_FILTER_LINEAR, VkFilter minFilter = VK_FILTER_LINEAR);
+		void DestroySampler(VkSampler sampler);
 
 		[[nodiscard]] VkFramebuffer CreateFrameBuffer(const VkImageView* imageViews, uint32_t imageViewCount, VkRenderPass renderPass, VkExtent2D extent) const;
 		void DestroyFrameBuffer(VkFramebuffer frameBuffer) const;
@@ -85,21 +101,35 @@ namespace vi
 		[[nodiscard]] VkBuffer CreateBuffer(uint32_t count, VkBufferUsageFlags flags) const;
 		void DestroyBuffer(VkBuffer buffer) const;
 
-		[[nodiscard]] VkDeviceMemory AllocateMemory(VkImage image, VkMemoryPropertyFlags flags) const;
-		[[nodiscard]] VkDeviceMemory AllocateMemory(VkBuffer buffer, VkMemoryPropertyFlags flags) const;
-		[[nodiscard]] VkDeviceMemory AllocateMemory(VkMemoryRequirements memRequirements, VkMemoryPropertyFlags flags) const;
+		// Memory is sub-allocated from larger blocks, so it has to be bound at the offset of the allocation.
+		[[nodiscard]] Allocation AllocateMemory(VkImage image, VkMemoryPropertyFlags flags);
+		[[nodiscard]] Allocation AllocateMemory(VkBuffer buffer, VkMemoryPropertyFlags flags);
+		[[nodiscard]] Allocation AllocateMemory(VkMemoryRequirements memRequirements, VkMemoryPropertyFlags flags, bool image = false);
 
-		void BindMemory(VkImage image, VkDeviceMemory memory) const;
-		void BindMemory(VkBuffer buffer, VkDeviceMemory memory) const;
+		void BindMemory(VkImage image, const Allocation& allocation) const;
+		void BindMemory(VkBuffer buffer, const Allocation& allocation) const;
 
-		void FreeMemory(VkDeviceMemory memory) const;
+		void FreeMemory(const Allocation& allocation);
 		template <typename T>
-		void MapMemory(VkDeviceMemory memory, T* input, VkDeviceSize offset, uint32_t count);
+		void MapMemory(const Allocation& allocation, T* input, VkDeviceSize offset, uint32_t count);
+		// Host visible memory is always mapped, so host coherent memory can be written to at any time without flushing.
+		[[nodiscard]] void* MapMemory(const Allocation& allocation) const;
 
 		void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0) const;
-		void CopyBuffer(VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height) const;
+		void CopyBuffer(VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height, VkDeviceSize srcOffset = 0) const;
 
 		void TransitionImageLayout(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout) const;
+		// Makes the writes of the source stages visible to the destination stages, for all resources at once.
+		void PipelineBarrier(VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, 
+			VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) const;
+
+		// Hands resources that have been written on a dedicated transfer queue over to the graphics queue.
+		// The release is recorded on the transfer queue, and the acquire on the graphics queue after waiting for the release.
+		void ReleaseOwnership(VkBuffer buffer) const;
+		void ReleaseOwnership(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout) const;
+		void AcquireOwnership(VkBuffer buffer, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) const;
+		void AcquireOwnership(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, 
+			VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) const;
 
 		void BeginCommandBufferRecording(VkCommandBuffer commandBuffer);
 		void EndCommandBufferRecording() const;
@@ -110,16 +140,24 @@ namespace vi
 
 		void BindPipeline(Pipeline pipeline);
 		void BindDescriptorSets(VkDescriptorSet* sets, uint32_t setCount) const;
+		// Dynamic offsets are consumed in order by the dynamic bindings of the sets.
+		void BindDescriptorSets(VkDescriptorSet* sets, uint32_t setCount, const uint32_t* dynamicOffsets, uint32_t dynamicOffsetCount) const;
 
 		void BindVertexBuffer(VkBuffer buffer) const;
+		void BindVertexBuffer(VkBuffer buffer, uint32_t binding, VkDeviceSize offset = 0) const;
 		void BindIndicesBuffer(VkBuffer buffer) const;
 
 		template <typename T>
 		void UpdatePushConstant(VkPipelineLayout layout, VkFlags flag, const T& input);
 
 		void Draw(uint32_t indexCount) const;
+		void Draw(uint32_t indexCount, uint32_t instanceCount, uint32_t firstInstance = 0) const;
 		void Submit(VkCommandBuffer* buffers, uint32_t buffersCount, 
 			VkSemaphore waitSemaphore = VK_NULL_HANDLE, VkSemaphore signalSemaphore = VK_NULL_HANDLE, VkFence fence = VK_NULL_HANDLE) const;
+		void Submit(VkCommandBuffer* buffers, uint32_t buffersCount, const VkSemaphore* waitSemaphores, const VkPipelineStageFlags* waitStages,
+			uint32_t waitSemaphoresCount, VkSemaphore signalSemaphore = VK_NULL_HANDLE, VkFence fence = VK_NULL_HANDLE) const;
+		void SubmitTransfer(VkCommandBuffer* buffers, uint32_t buffersCount, 
+			VkSemaphore signalSemaphore = VK_NULL_HANDLE, VkFence fence = VK_NULL_HANDLE) const;
 
 		[[nodiscard]] uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
 
@@ -129,6 +167,10 @@ namespace vi
 			VkImageTiling tiling, VkFormatFeatureFlags features) const;
 
 		[[nodiscard]] VkFormat GetDepthBufferFormat() const;
+		[[nodiscard]] const VkPhysicalDeviceProperties& GetPhysicalDeviceProperties() const;
+		[[nodiscard]] uint32_t GetDeviceAllocationCount() const;
+		// Without a dedicated transfer queue family, the transfer queue is the graphics queue.
+		[[nodiscard]] bool HasTransferQueue() const;
 
 	private:
 		std::unique_ptr<Settings> _settings{};
@@ -139,12 +181,25 @@ namespace vi
 		VkInstance _instance;
 		VkSurfaceKHR _surface;
 		VkPhysicalDevice _physicalDevice;
+		VkPhysicalDeviceProperties _physicalDeviceProperties;
+		VkPhysicalDeviceMemoryProperties _memoryProperties;
+		PhysicalDeviceFactory::QueueFamilies _queueFamilies;
 		VkDevice _device;
 		Queues _queues;
 		VkCommandPool _commandPool;
+		VkCommandPool _transferCommandPool;
 
 		VkCommandBuffer _currentCommandBuffer;
 		Pipeline _currentPipeline;
+
+		[[nodiscard]] VkBufferMemoryBarrier CreateOwnershipBarrier(VkBuffer buffer) const;
+		[[nodiscard]] VkImageMemoryBarrier CreateOwnershipBarrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout) const;
+
+		MemoryAllocator _allocator{};
+
+		ObjectCache<VkSampler> _samplers{};
+		ObjectCache<VkDescriptorSetLayout> _layouts{};
+		ObjectCache<VkPipelineLayout> _pipelineLayouts{};
 	};
 
 	template <typename T>
@@ -163,13 +218,9 @@ namespace vi
 	}
 
 	template <typename T>
-	void VkRenderer::MapMemory(const VkDeviceMemory memory, T* input, const VkDeviceSize offset, const uint32_t count)
+	void VkRenderer::MapMemory(const Allocation& allocation, T* input, const VkDeviceSize offset, const uint32_t count)
 	{
-		void* data;
-		const uint32_t size = count * sizeof(T);
-		vkMapMemory(_device, memory, offset, size, 0, &data);
-		memcpy(data, input, size);
-		vkUnmapMemory(_device, memory);
+		memcpy(static_cast<char*>(MapMemory(allocation)) + offset, input, count * sizeof(T));
 	}
 
 	template <typename T>
@@ -14,12 +14,22 @@ namespace vi
 		poolInfo.queueFamilyIndex = families.graphics;
 		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-		const auto result = vkCreateCommandPool(renderer._device, &poolInfo, nullptr, &renderer._commandPool);
+		auto result = vkCreateCommandPool(renderer._device, &poolInfo, nullptr, &renderer._commandPool);
+		assert(!result);
+
+		renderer._transferCommandPool = renderer._commandPool;
+		if (families.transfer == families.graphics)
+			return;
+
+		poolInfo.queueFamilyIndex = families.transfer;
+		result = vkCreateCommandPool(renderer._device, &poolInfo, nullptr, &renderer._transferCommandPool);
 		assert(!result);
 	}
 
 	void CommandPoolFactory::Cleanup(VkRenderer& renderer)
 	{
+		if (renderer._transferCommandPool != renderer._commandPool)
+			vkDestroyCommandPool(renderer._device, renderer._transferCommandPool, nullptr);
 		vkDestroyCommandPool(renderer._device, renderer._commandPool, nullptr);
 	}
 }
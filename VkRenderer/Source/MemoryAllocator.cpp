@@ -0,0 +1,174 @@
+﻿#include "pch.h"
+#include "MemoryAllocator.h"
+#include "VkRenderer.h"
+
+namespace vi
+{
+	void MemoryAllocator::Construct(VkRenderer& renderer)
+	{
+		Construct(renderer, Settings());
+	}
+
+	void MemoryAllocator::Construct(VkRenderer& renderer, const Settings& settings)
+	{
+		_renderer = &renderer;
+		_settings = settings;
+
+		_orderCount = 1;
+		while (_settings.minAllocationSize << (_orderCount - 1) < _settings.blockSize)
+			_orderCount++;
+		assert(_settings.minAllocationSize << (_orderCount - 1) == _settings.blockSize);
+	}
+
+	void MemoryAllocator::Cleanup()
+	{
+		for (const auto& block : _blocks)
+			vkFreeMemory(_renderer->_device, block.memory, nullptr);
+		_blocks.clear();
+	}
+
+	Allocation MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, const VkMemoryPropertyFlags flags, const bool image)
+	{
+		const uint32_t memoryTypeIndex = _renderer->FindMemoryType(requirements.memoryTypeBits, flags);
+
+		VkDeviceSize size = std::max(requirements.size, requirements.alignment);
+		if (image)
+			size = std::max(size, _renderer->_physicalDeviceProperties.limits.bufferImageGranularity);
+
+		Allocation allocation{};
+
+		if (size > _settings.dedicatedSize || size > _settings.blockSize)
+		{
+			allocation.memory = AllocateDeviceMemory(requirements.size, memoryTypeIndex, &allocation.data);
+
+			std::lock_guard<std::mutex> guard(_mutex);
+			_dedicatedCount++;
+			return allocation;
+		}
+
+		// Ranges are aligned to their own size, which is a power of two, so they also meet the alignment.
+		uint32_t order = 0;
+		while (_settings.minAllocationSize << order < size)
+			order++;
+		allocation.order = order;
+
+		std::lock_guard<std::mutex> guard(_mutex);
+
+		for (uint32_t i = 0; i < _blocks.size(); ++i)
+		{
+			auto& block = _blocks[i];
+			if (block.memoryTypeIndex != memoryTypeIndex || block.image != image)
+				continue;
+			if (!AllocateFromBlock(block, order, allocation.offset))
+				continue;
+
+			allocation.block = i;
+			break;
+		}
+
+		if (allocation.block == Allocation::dedicated)
+		{
+			Block block{};
+			block.memory = AllocateDeviceMemory(_settings.blockSize, memoryTypeIndex, &block.data);
+			block.memoryTypeIndex = memoryTypeIndex;
+			block.image = image;
+			block.freeRanges.resize(_orderCount);
+			block.freeRanges.back().insert(0);
+
+			const bool allocated = AllocateFromBlock(block, order, allocation.offset);
+			assert(allocated);
+
+			allocation.block = static_cast<uint32_t>(_blocks.size());
+			_blocks.push_back(std::move(block));
+		}
+
+		const auto& block = _blocks[allocation.block];
+		allocation.memory = block.memory;
+		if (block.data)
+			allocation.data = static_cast<char*>(block.data) + allocation.offset;
+		return allocation;
+	}
+
+	void MemoryAllocator::Free(const Allocation& allocation)
+	{
+		if (allocation.block == Allocation::dedicated)
+		{
+			vkFreeMemory(_renderer->_device, allocation.memory, nullptr);
+
+			std::lock_guard<std::mutex> guard(_mutex);
+			_dedicatedCount--;
+			return;
+		}
+
+		std::lock_guard<std::mutex> guard(_mutex);
+		auto& freeRanges = _blocks[allocation.block].freeRanges;
+
+		// Merge the range with its buddy for as long as the buddy is free.
+		VkDeviceSize offset = allocation.offset;
+		uint32_t order = allocation.order;
+		while (order + 1 < _orderCount)
+		{
+			const VkDeviceSize buddy = offset ^ _settings.minAllocationSize << order;
+			const auto found = freeRanges[order].find(buddy);
+			if (found == freeRanges[order].end())
+				break;
+
+			freeRanges[order].erase(found);
+			offset = std::min(offset, buddy);
+			order++;
+		}
+
+		freeRanges[order].insert(offset);
+	}
+
+	uint32_t MemoryAllocator::GetDeviceAllocationCount() const
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		return static_cast<uint32_t>(_blocks.size()) + _dedicatedCount;
+	}
+
+	VkDeviceMemory MemoryAllocator::AllocateDeviceMemory(const VkDeviceSize size, const uint32_t memoryTypeIndex, void** data) const
+	{
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+		VkDeviceMemory memory;
+		auto result = vkAllocateMemory(_renderer->_device, &allocInfo, nullptr, &memory);
+		assert(!result);
+
+		// Memory can only be mapped once, so host visible memory is mapped for its whole lifetime.
+		*data = nullptr;
+		const auto& memoryType = _renderer->_memoryProperties.memoryTypes[memoryTypeIndex];
+		if (memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			result = vkMapMemory(_renderer->_device, memory, 0, VK_WHOLE_SIZE, 0, data);
+			assert(!result);
+		}
+
+		return memory;
+	}
+
+	bool MemoryAllocator::AllocateFromBlock(Block& block, const uint32_t order, VkDeviceSize& offset) const
+	{
+		// Take the smallest free range that fits, and split it until it has the right size.
+		uint32_t current = order;
+		while (current < _orderCount && block.freeRanges[current].empty())
+			current++;
+		if (current == _orderCount)
+			return false;
+
+		auto& freeRanges = block.freeRanges[current];
+		offset = *freeRanges.begin();
+		freeRanges.erase(freeRanges.begin());
+
+		while (current > order)
+		{
+			current--;
+			block.freeRanges[current].insert(offset + (_settings.minAllocationSize << current));
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -128,11 +128,27 @@ namespace vi
 			if (presentSupport)
 				families.present = i;
 
-			if (families)
+			if (families.graphics != UINT32_MAX && families.present != UINT32_MAX)
 				break;
 			i++;
 		}
 
+		// Families that only support transfers are usually backed by dedicated copy engines.
+		i = 0;
+		for (const auto& queueFamily : queueFamilies)
+		{
+			const auto flags = queueFamily.queueFlags;
+			if (flags & VK_QUEUE_TRANSFER_BIT && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+			{
+				families.transfer = i;
+				break;
+			}
+			i++;
+		}
+
+		if (families.transfer == UINT32_MAX)
+			families.transfer = families.graphics;
+
 		return families;
 	}
 }
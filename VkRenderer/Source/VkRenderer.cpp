@@ -24,14 +24,34 @@ namespace vi
 		_windowSystem->CreateSurface(_instance, _surface);
 
 		PhysicalDeviceFactory{ *this, settings.physicalDevice };
+		vkGetPhysicalDeviceProperties(_physicalDevice, &_physicalDeviceProperties);
+		vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &_memoryProperties);
+		_queueFamilies = PhysicalDeviceFactory::GetQueueFamilies(_surface, _physicalDevice);
+
 		LogicalDeviceFactory{ *this };
 		CommandPoolFactory{ *this };
+		_allocator.Construct(*this, settings.memory);
 	}
 
 	void VkRenderer::Cleanup()
 	{
 		DeviceWaitIdle();
 
+		// Objects that are still in use at this point have been leaked by their creators.
+		_pipelineLayouts.Clear([this](const VkPipelineLayout layout)
+		{
+			vkDestroyPipelineLayout(_device, layout, nullptr);
+		});
+		_layouts.Clear([this](const VkDescriptorSetLayout layout)
+		{
+			vkDestroyDescriptorSetLayout(_device, layout, nullptr);
+		});
+		_samplers.Clear([this](const VkSampler sampler)
+		{
+			vkDestroySampler(_device, sampler, nullptr);
+		});
+
+		_allocator.Cleanup();
 		CommandPoolFactory::Cleanup(*this);
 		LogicalDeviceFactory::Cleanup(*this);
 		_debugger.Cleanup();
@@ -148,42 +168,70 @@ namespace vi
 		vkDestroyRenderPass(_device, renderPass, nullptr);
 	}
 
-	VkDescriptorSetLayout VkRenderer::CreateLayout(const DescriptorLayoutInfo& info) const
+	VkDescriptorSetLayout VkRenderer::CreateLayout(const DescriptorLayoutInfo& info)
 	{
-		const uint32_t bindingsCount = info.bindings.size();
-		std::vector<VkDescriptorSetLayoutBinding> layoutBindings{};
-		layoutBindings.resize(bindingsCount);
+		ObjectCache<VkDescriptorSetLayout>::Key key{};
+		for (const auto& binding : info.bindings)
+		{
+			key.push_back(binding.type);
+			key.push_back(binding.count);
+			key.push_back(binding.flag);
+			key.push_back(binding.bindingFlags);
+		}
 
-		for (uint32_t i = 0; i < bindingsCount; ++i)
+		return _layouts.Acquire(key, [&]
 		{
-			const auto& binding = info.bindings[i];
-			auto& uboLayoutBinding = layoutBindings[i];
+			const uint32_t bindingsCount = info.bindings.size();
+			std::vector<VkDescriptorSetLayoutBinding> layoutBindings{};
+			layoutBindings.resize(bindingsCount);
+			std::vector<VkDescriptorBindingFlagsEXT> bindingFlags{};
+			bindingFlags.resize(bindingsCount);
+			VkDescriptorBindingFlagsEXT combinedFlags = 0;
+
+			for (uint32_t i = 0; i < bindingsCount; ++i)
+			{
+				const auto& binding = info.bindings[i];
+				auto& uboLayoutBinding = layoutBindings[i];
 
-			uboLayoutBinding.binding = i;
-			uboLayoutBinding.descriptorType = binding.type;
-			uboLayoutBinding.descriptorCount = binding.count;
-			uboLayoutBinding.stageFlags = binding.flag;
-		}
+				uboLayoutBinding.binding = i;
+				uboLayoutBinding.descriptorType = binding.type;
+				uboLayoutBinding.descriptorCount = binding.count;
+				uboLayoutBinding.stageFlags = binding.flag;
 
-		VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		layoutInfo.pNext = nullptr;
-		layoutInfo.flags = 0;
-		layoutInfo.bindingCount = bindingsCount;
-		layoutInfo.pBindings = layoutBindings.data();
+				bindingFlags[i] = binding.bindingFlags;
+				combinedFlags |= binding.bindingFlags;
+			}
 
-		VkDescriptorSetLayout layout;
-		const auto result = vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &layout);
-		assert(!result);
-		return layout;
+			VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+			bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+			bindingFlagsInfo.bindingCount = bindingsCount;
+			bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+			VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+			layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+			// Binding flags are only passed when used, since they require descriptor indexing.
+			layoutInfo.pNext = combinedFlags ? &bindingFlagsInfo : nullptr;
+			layoutInfo.flags = combinedFlags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT ?
+				VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT : 0;
+			layoutInfo.bindingCount = bindingsCount;
+			layoutInfo.pBindings = layoutBindings.data();
+
+			VkDescriptorSetLayout layout;
+			const auto result = vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &layout);
+			assert(!result);
+
+			return layout;
+		});
 	}
 
-	void VkRenderer::DestroyLayout(const VkDescriptorSetLayout layout) const
+	void VkRenderer::DestroyLayout(const VkDescriptorSetLayout layout)
 	{
-		vkDestroyDescriptorSetLayout(_device, layout, nullptr);
+		if (_layouts.Release(layout))
+			vkDestroyDescriptorSetLayout(_device, layout, nullptr);
 	}
 
-	VkDescriptorPool VkRenderer::CreateDescriptorPool(VkDescriptorType* types, const uint32_t typeCount, const uint32_t maxSets) const
+	VkDescriptorPool VkRenderer::CreateDescriptorPool(VkDescriptorType* types, const uint32_t typeCount, const uint32_t maxSets,
+		const uint32_t descriptorsPerSet, const VkDescriptorPoolCreateFlags flags) const
 	{
 		std::vector<VkDescriptorPoolSize> sizes{};
 		sizes.resize(typeCount);
@@ -192,11 +240,12 @@ namespace vi
 		{
 			auto& size = sizes[i];
 			size.type = types[i];
-			size.descriptorCount = maxSets;
+			size.descriptorCount = maxSets * descriptorsPerSet;
 		}
 
 		VkDescriptorPoolCreateInfo poolInfo{};
 		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = flags;
 		poolInfo.poolSizeCount = typeCount;
 		poolInfo.pPoolSizes = sizes.data();
 		poolInfo.maxSets = maxSets;
@@ -235,7 +284,7 @@ namespace vi
 		descriptorWrite.dstSet = set;
 		descriptorWrite.dstBinding = bindingIndex;
 		descriptorWrite.dstArrayElement = arrayIndex;
-		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		descriptorWrite.descriptorType = info.type;
 		descriptorWrite.descriptorCount = 1;
 		descriptorWrite.pBufferInfo = &bufferInfo;
 
@@ -262,12 +311,38 @@ namespace vi
 		vkUpdateDescriptorSets(_device, 1, &descriptorWrite, 0, nullptr);
 	}
 
+	void VkRenderer::BindSamplers(const VkDescriptorSet* sets, const VkImageView* imageViews, const VkSampler* samplers,
+		const uint32_t count, const uint32_t bindingIndex, const uint32_t arrayIndex) const
+	{
+		std::vector<VkDescriptorImageInfo> imageInfos(count);
+		std::vector<VkWriteDescriptorSet> descriptorWrites(count);
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			auto& imageInfo = imageInfos[i];
+			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			imageInfo.imageView = imageViews[i];
+			imageInfo.sampler = samplers[i];
+
+			auto& descriptorWrite = descriptorWrites[i];
+			descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrite.dstSet = sets[i];
+			descriptorWrite.dstBinding = bindingIndex;
+			descriptorWrite.dstArrayElement = arrayIndex;
+			descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			descriptorWrite.descriptorCount = 1;
+			descriptorWrite.pImageInfo = &imageInfo;
+		}
+
+		vkUpdateDescriptorSets(_device, count, descriptorWrites.data(), 0, nullptr);
+	}
+
 	void VkRenderer::DestroyDescriptorPool(const VkDescriptorPool pool) const
 	{
 		vkDestroyDescriptorPool(_device, pool, nullptr);
 	}
 
-	Pipeline VkRenderer::CreatePipeline(const PipelineLayoutInfo& info) const
+	Pipeline VkRenderer::CreatePipeline(const PipelineLayoutInfo& info)
 	{
 		std::vector<VkPipelineShaderStageCreateInfo> modules{};
 		
@@ -287,9 +362,9 @@ namespace vi
 
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vertexInputInfo.vertexBindingDescriptionCount = 1;
+		vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(info.bindingDescriptions.size());
 		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(info.attributeDescriptions.size());
-		vertexInputInfo.pVertexBindingDescriptions = &info.bindingDescription;
+		vertexInputInfo.pVertexBindingDescriptions = info.bindingDescriptions.data();
 		vertexInputInfo.pVertexAttributeDescriptions = info.attributeDescriptions.data();
 
 		VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -368,16 +443,36 @@ namespace vi
 		depthStencil.depthBoundsTestEnable = VK_FALSE;
 		depthStencil.stencilTestEnable = VK_FALSE;
 
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = info.setLayouts.size();
-		pipelineLayoutInfo.pSetLayouts = info.setLayouts.data();
-		pipelineLayoutInfo.pushConstantRangeCount = info.pushConstants.size();
-		pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+		// Set layouts are identified by their bindings instead of their handles, which can be reused once they are destroyed.
+		// Layouts with the same bindings are compatible, so the pipeline layout can be shared between them.
+		ObjectCache<VkPipelineLayout>::Key key{};
+		key.push_back(info.setLayouts.size());
+		for (const auto& setLayout : info.setLayouts)
+		{
+			const auto setKey = _layouts.GetKey(setLayout);
+			key.push_back(setKey.size());
+			key.insert(key.end(), setKey.begin(), setKey.end());
+		}
+		for (const auto& pushConstant : info.pushConstants)
+		{
+			key.push_back(pushConstant.size);
+			key.push_back(pushConstant.flag);
+		}
 
-		VkPipelineLayout pipelineLayout;
-		auto result = vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &pipelineLayout);
-		assert(!result);
+		const VkPipelineLayout pipelineLayout = _pipelineLayouts.Acquire(key, [&]
+		{
+			VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+			pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+			pipelineLayoutInfo.setLayoutCount = info.setLayouts.size();
+			pipelineLayoutInfo.pSetLayouts = info.setLayouts.data();
+			pipelineLayoutInfo.pushConstantRangeCount = info.pushConstants.size();
+			pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+			VkPipelineLayout layout;
+			const auto result = vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &layout);
+			assert(!result);
+			return layout;
+		});
 		
 		VkGraphicsPipelineCreateInfo pipelineInfo{};
 		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -398,7 +493,7 @@ namespace vi
 		pipelineInfo.basePipelineIndex = info.basePipelineIndex;
 
 		VkPipeline graphicsPipeline;
-		result = vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline);
+		const auto result = vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline);
 		assert(!result);
 
 		return
@@ -408,17 +503,18 @@ namespace vi
 		};
 	}
 
-	void VkRenderer::DestroyPipeline(const Pipeline pipeline) const
+	void VkRenderer::DestroyPipeline(const Pipeline pipeline)
 	{
 		vkDestroyPipeline(_device, pipeline.pipeline, nullptr);
-		vkDestroyPipelineLayout(_device, pipeline.layout, nullptr);
+		if (_pipelineLayouts.Release(pipeline.layout))
+			vkDestroyPipelineLayout(_device, pipeline.layout, nullptr);
 	}
 
-	VkCommandBuffer VkRenderer::CreateCommandBuffer() const
+	VkCommandBuffer VkRenderer::CreateCommandBuffer(const bool transfer) const
 	{
 		VkCommandBufferAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.commandPool = _commandPool;
+		allocInfo.commandPool = transfer ? _transferCommandPool : _commandPool;
 		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 		allocInfo.commandBufferCount = 1;
 
@@ -429,9 +525,9 @@ namespace vi
 		return commandBuffer;
 	}
 
-	void VkRenderer::DestroyCommandBuffer(const VkCommandBuffer commandBuffer) const
+	void VkRenderer::DestroyCommandBuffer(const VkCommandBuffer commandBuffer, const bool transfer) const
 	{
-		vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
+		vkFreeCommandBuffers(_device, transfer ? _transferCommandPool : _commandPool, 1, &commandBuffer);
 	}
 
 	VkImage VkRenderer::CreateImage(const glm::ivec2 resolution, const VkFormat format,
@@ -495,38 +591,41 @@ namespace vi
 		vkDestroyImageView(_device, imageView, nullptr);
 	}
 
-	VkSampler VkRenderer::CreateSampler(const VkFilter magFilter, const VkFilter minFilter) const
-	{
-		VkPhysicalDeviceProperties properties{};
-		vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
-
-		VkSamplerCreateInfo samplerInfo{};
-		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-		samplerInfo.magFilter = magFilter;
-		samplerInfo.minFilter = minFilter;
-		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		samplerInfo.anisotropyEnable = VK_TRUE;
-		samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
-		samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-		samplerInfo.unnormalizedCoordinates = VK_FALSE;
-		samplerInfo.compareEnable = VK_FALSE;
-		samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-		samplerInfo.mipLodBias = 0.0f;
-		samplerInfo.minLod = 0.0f;
-		samplerInfo.maxLod = 0.0f;
-
-		VkSampler sampler;
-		const auto result = vkCreateSampler(_device, &samplerInfo, nullptr, &sampler);
-		assert(!result);
-		return sampler;
+	VkSampler VkRenderer::CreateSampler(const VkFilter magFilter, const VkFilter minFilter)
+	{
+		const ObjectCache<VkSampler>::Key key{ static_cast<uint64_t>(magFilter), static_cast<uint64_t>(minFilter) };
+		return _samplers.Acquire(key, [&]
+		{
+			VkSamplerCreateInfo samplerInfo{};
+			samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+			samplerInfo.magFilter = magFilter;
+			samplerInfo.minFilter = minFilter;
+			samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			samplerInfo.anisotropyEnable = VK_TRUE;
+			samplerInfo.maxAnisotropy = _physicalDeviceProperties.limits.maxSamplerAnisotropy;
+			samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+			samplerInfo.unnormalizedCoordinates = VK_FALSE;
+			samplerInfo.compareEnable = VK_FALSE;
+			samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+			samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+			samplerInfo.mipLodBias = 0.0f;
+			samplerInfo.minLod = 0.0f;
+			samplerInfo.maxLod = 0.0f;
+
+			VkSampler sampler;
+			const auto result = vkCreateSampler(_device, &samplerInfo, nullptr, &sampler);
+			assert(!result);
+
+			return sampler;
+		});
 	}
 
-	void VkRenderer::DestroySampler(const VkSampler sampler) const
+	void VkRenderer::DestroySampler(const VkSampler sampler)
 	{
-		vkDestroySampler(_device, sampler, nullptr);
+		if (_samplers.Release(sampler))
+			vkDestroySampler(_device, sampler, nullptr);
 	}
 
 	VkFramebuffer VkRenderer::CreateFrameBuffer(const VkImageView* imageViews, const uint32_t imageViewCount, 
@@ -604,11 +703,11 @@ namespace vi
 		vkDestroyBuffer(_device, buffer, nullptr);
 	}
 
-	VkDeviceMemory VkRenderer::AllocateMemory(const VkImage image, const VkMemoryPropertyFlags flags) const
+	Allocation VkRenderer::AllocateMemory(const VkImage image, const VkMemoryPropertyFlags flags)
 	{
 		VkMemoryRequirements memRequirements;
 		vkGetImageMemoryRequirements(_device, image, &memRequirements);
-		return AllocateMemory(memRequirements, flags);
+		return AllocateMemory(memRequirements, flags, true);
 	}
 
 	void VkRenderer::WaitForFence(const VkFence fence) const
@@ -616,7 +715,7 @@ namespace vi
 		vkWaitForFences(_device, 1, &fence, VK_TRUE, UINT64_MAX);
 	}
 
-	VkDeviceMemory VkRenderer::AllocateMemory(const VkBuffer buffer, const VkMemoryPropertyFlags flags) const
+	Allocation VkRenderer::AllocateMemory(const VkBuffer buffer, const VkMemoryPropertyFlags flags)
 	{
 		VkMemoryRequirements memRequirements;
 		vkGetBufferMemoryRequirements(_device, buffer, &memRequirements);
@@ -624,33 +723,30 @@ namespace vi
 		return AllocateMemory(memRequirements, flags);
 	}
 
-	VkDeviceMemory VkRenderer::AllocateMemory(const VkMemoryRequirements memRequirements, const VkMemoryPropertyFlags flags) const
+	Allocation VkRenderer::AllocateMemory(const VkMemoryRequirements memRequirements, const VkMemoryPropertyFlags flags, const bool image)
 	{
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, flags);
-
-		VkDeviceMemory memory;
-		const auto result = vkAllocateMemory(_device, &allocInfo, nullptr, &memory);
-		assert(!result);
+		return _allocator.Allocate(memRequirements, flags, image);
+	}
 
-		return memory;
+	void VkRenderer::BindMemory(const VkImage image, const Allocation& allocation) const
+	{
+		vkBindImageMemory(_device, image, allocation.memory, allocation.offset);
 	}
 
-	void VkRenderer::BindMemory(const VkImage image, const VkDeviceMemory memory) const
+	void VkRenderer::BindMemory(const VkBuffer buffer, const Allocation& allocation) const
 	{
-		vkBindImageMemory(_device, image, memory, 0);
+		vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset);
 	}
 
-	void VkRenderer::BindMemory(const VkBuffer buffer, const VkDeviceMemory memory) const
+	void VkRenderer::FreeMemory(const Allocation& allocation)
 	{
-		vkBindBufferMemory(_device, buffer, memory, 0);
+		_allocator.Free(allocation);
 	}
 
-	void VkRenderer::FreeMemory(const VkDeviceMemory memory) const
+	void* VkRenderer::MapMemory(const Allocation& allocation) const
 	{
-		vkFreeMemory(_device, memory, nullptr);
+		assert(allocation.data);
+		return allocation.data;
 	}
 
 	void VkRenderer::CopyBuffer(const VkBuffer srcBuffer, const VkBuffer dstBuffer, const VkDeviceSize size, 
@@ -663,10 +759,11 @@ namespace vi
 		vkCmdCopyBuffer(_currentCommandBuffer, srcBuffer, dstBuffer, 1, &region);
 	}
 
-	void VkRenderer::CopyBuffer(const VkBuffer srcBuffer, const VkImage dstImage, const uint32_t width, const uint32_t height) const
+	void VkRenderer::CopyBuffer(const VkBuffer srcBuffer, const VkImage dstImage, const uint32_t width, const uint32_t height, 
+		const VkDeviceSize srcOffset) const
 	{
 		VkBufferImageCopy region{};
-		region.bufferOffset = 0;
+		region.bufferOffset = srcOffset;
 		region.bufferRowLength = 0;
 		region.bufferImageHeight = 0;
 		region.imageOffset = { 0, 0, 0 };
@@ -750,6 +847,81 @@ namespace vi
 		);
 	}
 
+	void VkRenderer::PipelineBarrier(const VkPipelineStageFlags srcStage, const VkAccessFlags srcAccess,
+		const VkPipelineStageFlags dstStage, const VkAccessFlags dstAccess) const
+	{
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+
+		vkCmdPipelineBarrier(_currentCommandBuffer,
+			srcStage, dstStage,
+			0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr
+		);
+	}
+
+	void VkRenderer::ReleaseOwnership(const VkBuffer buffer) const
+	{
+		auto barrier = CreateOwnershipBarrier(buffer);
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(_currentCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0, nullptr,
+			1, &barrier,
+			0, nullptr
+		);
+	}
+
+	void VkRenderer::ReleaseOwnership(const VkImage image, const VkImageLayout oldLayout, const VkImageLayout newLayout) const
+	{
+		auto barrier = CreateOwnershipBarrier(image, oldLayout, newLayout);
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(_currentCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier
+		);
+	}
+
+	void VkRenderer::AcquireOwnership(const VkBuffer buffer, const VkPipelineStageFlags dstStage, const VkAccessFlags dstAccess) const
+	{
+		auto barrier = CreateOwnershipBarrier(buffer);
+		barrier.dstAccessMask = dstAccess;
+
+		// The source stage matches the stage that waits for the release, which chains the two.
+		vkCmdPipelineBarrier(_currentCommandBuffer,
+			dstStage, dstStage,
+			0,
+			0, nullptr,
+			1, &barrier,
+			0, nullptr
+		);
+	}
+
+	void VkRenderer::AcquireOwnership(const VkImage image, const VkImageLayout oldLayout, const VkImageLayout newLayout,
+		const VkPipelineStageFlags dstStage, const VkAccessFlags dstAccess) const
+	{
+		auto barrier = CreateOwnershipBarrier(image, oldLayout, newLayout);
+		barrier.dstAccessMask = dstAccess;
+
+		vkCmdPipelineBarrier(_currentCommandBuffer,
+			dstStage, dstStage,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier
+		);
+	}
+
 	void VkRenderer::BeginCommandBufferRecording(const VkCommandBuffer commandBuffer)
 	{
 		VkCommandBufferBeginInfo beginInfo{};
@@ -808,12 +980,24 @@ namespace vi
 			_currentPipeline.layout, 0, setCount, sets, 0, nullptr);
 	}
 
+	void VkRenderer::BindDescriptorSets(VkDescriptorSet* sets, const uint32_t setCount,
+		const uint32_t* dynamicOffsets, const uint32_t dynamicOffsetCount) const
+	{
+		vkCmdBindDescriptorSets(_currentCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+			_currentPipeline.layout, 0, setCount, sets, dynamicOffsetCount, dynamicOffsets);
+	}
+
 	void VkRenderer::BindVertexBuffer(const VkBuffer buffer) const
 	{
 		VkDeviceSize offset = 0;
 		vkCmdBindVertexBuffers(_currentCommandBuffer, 0, 1, &buffer, &offset);
 	}
 
+	void VkRenderer::BindVertexBuffer(const VkBuffer buffer, const uint32_t binding, const VkDeviceSize offset) const
+	{
+		vkCmdBindVertexBuffers(_currentCommandBuffer, binding, 1, &buffer, &offset);
+	}
+
 	void VkRenderer::BindIndicesBuffer(const VkBuffer buffer) const
 	{
 		vkCmdBindIndexBuffer(_currentCommandBuffer, buffer, 0, VK_INDEX_TYPE_UINT16);
@@ -824,30 +1008,58 @@ namespace vi
 		vkCmdDrawIndexed(_currentCommandBuffer, indexCount, 1, 0, 0, 0);
 	}
 
+	void VkRenderer::Draw(const uint32_t indexCount, const uint32_t instanceCount, const uint32_t firstInstance) const
+	{
+		vkCmdDrawIndexed(_currentCommandBuffer, indexCount, instanceCount, 0, 0, firstInstance);
+	}
+
 	void VkRenderer::Submit(VkCommandBuffer* buffers, const uint32_t buffersCount,
 		const VkSemaphore waitSemaphore, const VkSemaphore signalSemaphore, const VkFence fence) const
+	{
+		const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		Submit(buffers, buffersCount, &waitSemaphore, &waitStage, waitSemaphore ? 1 : 0, signalSemaphore, fence);
+	}
+
+	void VkRenderer::Submit(VkCommandBuffer* buffers, const uint32_t buffersCount, 
+		const VkSemaphore* waitSemaphores, const VkPipelineStageFlags* waitStages, const uint32_t waitSemaphoresCount, 
+		const VkSemaphore signalSemaphore, const VkFence fence) const
 	{
 		VkSubmitInfo submitInfo{};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		submitInfo.waitSemaphoreCount = waitSemaphore ? 1 : 0;
-		submitInfo.pWaitSemaphores = &waitSemaphore;
-		submitInfo.pWaitDstStageMask = &waitStage;
+		submitInfo.waitSemaphoreCount = waitSemaphoresCount;
+		submitInfo.pWaitSemaphores = waitSemaphores;
+		submitInfo.pWaitDstStageMask = waitStages;
 		submitInfo.commandBufferCount = buffersCount;
 		submitInfo.pCommandBuffers = buffers;
 		submitInfo.signalSemaphoreCount = signalSemaphore ? 1 : 0;
 		submitInfo.pSignalSemaphores = &signalSemaphore;
 
-		vkResetFences(_device, 1, &fence);
+		if (fence)
+			vkResetFences(_device, 1, &fence);
 		const auto result = vkQueueSubmit(_queues.graphics, 1, &submitInfo, fence);
 		assert(!result);
 	}
 
+	void VkRenderer::SubmitTransfer(VkCommandBuffer* buffers, const uint32_t buffersCount, 
+		const VkSemaphore signalSemaphore, const VkFence fence) const
+	{
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = buffersCount;
+		submitInfo.pCommandBuffers = buffers;
+		submitInfo.signalSemaphoreCount = signalSemaphore ? 1 : 0;
+		submitInfo.pSignalSemaphores = &signalSemaphore;
+
+		if (fence)
+			vkResetFences(_device, 1, &fence);
+		const auto result = vkQueueSubmit(_queues.transfer, 1, &submitInfo, fence);
+		assert(!result);
+	}
+
 	uint32_t VkRenderer::FindMemoryType(const uint32_t typeFilter, const VkMemoryPropertyFlags properties) const
 	{
-		VkPhysicalDeviceMemoryProperties memProperties;
-		vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &memProperties);
+		const auto& memProperties = _memoryProperties;
 
 		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
 			if (typeFilter & 1 << i)
@@ -892,4 +1104,49 @@ namespace vi
 			VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
 		);
 	}
+
+	const VkPhysicalDeviceProperties& VkRenderer::GetPhysicalDeviceProperties() const
+	{
+		return _physicalDeviceProperties;
+	}
+
+	uint32_t VkRenderer::GetDeviceAllocationCount() const
+	{
+		return _allocator.GetDeviceAllocationCount();
+	}
+
+	bool VkRenderer::HasTransferQueue() const
+	{
+		return _queueFamilies.transfer != _queueFamilies.graphics;
+	}
+
+	VkBufferMemoryBarrier VkRenderer::CreateOwnershipBarrier(const VkBuffer buffer) const
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = _queueFamilies.transfer;
+		barrier.dstQueueFamilyIndex = _queueFamilies.graphics;
+		barrier.buffer = buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		return barrier;
+	}
+
+	VkImageMemoryBarrier VkRenderer::CreateOwnershipBarrier(const VkImage image, 
+		const VkImageLayout oldLayout, const VkImageLayout newLayout) const
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = _queueFamilies.transfer;
+		barrier.dstQueueFamilyIndex = _queueFamilies.graphics;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		return barrier;
+	}
 }